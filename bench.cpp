@@ -0,0 +1,112 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "perft.h"
+#include "search.h"
+
+using namespace std;
+
+// Fixed workload for timing the engine and for training profile-guided
+// builds: the per-node kernels, the perft suite, and a fixed-depth search
+// of each position below, or of the FENs in fen-file (one per line). Exits
+// with status 1 if a perft count is wrong or a FEN cannot be read.
+//
+//   ChessAI-bench [depth] [threads] [fen-file]
+//
+// The perft commands run on their own and need no display:
+//
+//   ChessAI-bench --perft=N [--fen=FEN] [--perft-hash=MB] [--threads=N]
+//   ChessAI-bench --perft-suite [--threads=N]
+//   ChessAI-bench --bench-kernels
+
+const char* bench_positions[] = {
+    STARTPOS_FEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+};
+
+int main(int argc, char* argv[]) {
+    vector<string> args;
+    int threads = max(1u, thread::hardware_concurrency());
+    int perftDepth = -1;
+    bool perftSuite = false;
+    bool benchKernels = false;
+    string perftFen = STARTPOS_FEN;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--perft=", 0) == 0) perftDepth = stoi(arg.substr(8));
+        else if (arg.rfind("--perft-hash=", 0) == 0) perft_table.resize(stoul(arg.substr(13)));
+        else if (arg == "--perft-suite") perftSuite = true;
+        else if (arg == "--bench-kernels") benchKernels = true;
+        else if (arg.rfind("--fen=", 0) == 0) perftFen = arg.substr(6);
+        else if (arg.rfind("--threads=", 0) == 0) threads = stoi(arg.substr(10));
+        else args.push_back(arg);
+    }
+    int depth = args.size() > 0 ? stoi(args[0]) : 6;
+    if (args.size() > 1) threads = stoi(args[1]);
+
+    init_bitboards();
+    search_pool.resize(threads);
+
+    if (perftSuite) return perft_suite() ? 0 : 1;
+    if (benchKernels) {
+        bench_kernels();
+        return 0;
+    }
+    if (perftDepth >= 0) {
+        Position board;
+        bool isWhiteTurn = true;
+        if (!board.set_fen(perftFen, isWhiteTurn)) {
+            cerr << "invalid FEN: " << perftFen << endl;
+            return 1;
+        }
+        perft_root(board, perftDepth, isWhiteTurn, true);
+        return 0;
+    }
+
+    vector<string> fens(begin(bench_positions), end(bench_positions));
+    if (args.size() > 2) {
+        ifstream file(args[2]);
+        if (!file) {
+            cerr << "cannot open " << args[2] << endl;
+            return 1;
+        }
+        fens.clear();
+        for (string line; getline(file, line);) {
+            if (line.find_first_not_of(" \t\r") != string::npos) fens.push_back(line);
+        }
+    }
+
+    bench_kernels();
+    bool passed = perft_suite();
+
+    uint64_t nodes = 0;
+    double seconds = 0;
+    for (const string& fen : fens) {
+        Position board;
+        bool isWhiteTurn = true;
+        if (!board.set_fen(fen, isWhiteTurn)) {
+            cerr << "invalid FEN: " << fen << endl;
+            passed = false;
+            continue;
+        }
+        transposition_table.clear();
+
+        SearchLimits limits;
+        limits.maxDepth = depth;
+        SearchStats stats;
+        Move move = find_best_move(board, isWhiteTurn, YBWC_SEARCH, limits, stats);
+        cout << fen << endl << "  bestmove " << move_to_uci(move) << ", score " << stats.score << ", "
+             << stats.nodes << " nodes in " << stats.seconds << "s" << endl;
+        nodes += stats.nodes;
+        seconds += stats.seconds;
+    }
+    cout << "search: " << nodes << " nodes in " << seconds << "s (" << uint64_t(nodes / max(seconds, 1e-9))
+         << " nodes/sec)" << endl;
+    return passed ? 0 : 1;
+}
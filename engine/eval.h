@@ -0,0 +1,24 @@
+// Static evaluation. The material and piece-square sums are kept in
+// Position as pieces move (see Position::update_eval); this only combines
+// them, so both calls are O(1).
+#ifndef CHESSAI_EVAL_H
+#define CHESSAI_EVAL_H
+
+#include "position.h"
+
+// Non-pawn material, both sides together, at or below which the king
+// switches to its endgame table
+#define ENDGAME_MATERIAL 3000
+
+// From white's point of view: material plus piece-square bonuses
+inline int evaluate_board(const Position& board) {
+    return board.material + (board.phaseMaterial <= ENDGAME_MATERIAL ? board.psqtEndgame : board.psqtMiddlegame);
+}
+
+// From the point of view of the side to move
+inline int evaluate_for(const Position& board, bool isWhiteTurn) {
+    int score = evaluate_board(board);
+    return isWhiteTurn ? score : -score;
+}
+
+#endif  // CHESSAI_EVAL_H
@@ -0,0 +1,308 @@
+#include "movegen.h"
+
+using namespace std;
+
+// Move generation writes through a sink with a push_back(Move) member: a
+// MoveList to collect the moves, or one of the sinks below that only count
+// or look for them
+
+template <typename MoveSink>
+void add_moves(MoveSink& moves, int from, Bitboard targets) {
+    while (targets) {
+        int to = pop_lsb(targets);
+        moves.push_back(Move(from, to));
+    }
+}
+
+Bitboard piece_attacks(Piece piece, int sq, Bitboard occupied) {
+    switch (piece) {
+        case WHITE_PAWN: return pawn_attacks[WHITE][sq];
+        case BLACK_PAWN: return pawn_attacks[BLACK][sq];
+        case WHITE_KNIGHT: case BLACK_KNIGHT: return knight_attacks[sq];
+        case WHITE_BISHOP: case BLACK_BISHOP: return bishop_attacks(sq, occupied);
+        case WHITE_ROOK: case BLACK_ROOK: return rook_attacks(sq, occupied);
+        case WHITE_QUEEN: case BLACK_QUEEN: return queen_attacks(sq, occupied);
+        case WHITE_KING: case BLACK_KING: return king_attacks[sq];
+        default: return 0;
+    }
+}
+
+Bitboard attackers_to(const Position& board, int sq, Bitboard occupied) {
+    const Bitboard bishops = board.pieces[WHITE_BISHOP] | board.pieces[BLACK_BISHOP] |
+                             board.pieces[WHITE_QUEEN] | board.pieces[BLACK_QUEEN];
+    const Bitboard rooks = board.pieces[WHITE_ROOK] | board.pieces[BLACK_ROOK] |
+                           board.pieces[WHITE_QUEEN] | board.pieces[BLACK_QUEEN];
+    return (pawn_attacks[BLACK][sq] & board.pieces[WHITE_PAWN]) |
+           (pawn_attacks[WHITE][sq] & board.pieces[BLACK_PAWN]) |
+           (knight_attacks[sq] & (board.pieces[WHITE_KNIGHT] | board.pieces[BLACK_KNIGHT])) |
+           (king_attacks[sq] & (board.pieces[WHITE_KING] | board.pieces[BLACK_KING])) |
+           (bishop_attacks(sq, occupied) & bishops) |
+           (rook_attacks(sq, occupied) & rooks);
+}
+
+// Works backwards from the square: a knight, king or pawn of that side
+// must stand on one of the squares the same piece would attack from sq, and
+// a slider on one of the rays from sq.
+bool is_square_attacked(const Position& board, int sq, bool byWhite) {
+    const Piece first = byWhite ? WHITE_PAWN : BLACK_PAWN;
+    if (pawn_attacks[byWhite ? BLACK : WHITE][sq] & board.pieces[first]) return true;
+    if (knight_attacks[sq] & board.pieces[first + 1]) return true;
+    if (king_attacks[sq] & board.pieces[first + 5]) return true;
+    const Bitboard queens = board.pieces[first + 4];
+    if (bishop_attacks(sq, board.occupied) & (board.pieces[first + 2] | queens)) return true;
+    return rook_attacks(sq, board.occupied) & (board.pieces[first + 3] | queens);
+}
+
+// Static exchange evaluation: material the side making a capture comes out
+// with once both sides have traded off on the target square, each always
+// recapturing with its least valuable attacker and free to stop whenever
+// continuing would lose. Pieces removed from the square's attack lines
+// uncover the sliders behind them. The sequence is cut short once its sign
+// is settled, so only the sign of the result is exact.
+int see(const Position& board, const Move& move) {
+    const int from = move.from(), to = move.to();
+    const Bitboard diagonal = board.pieces[WHITE_BISHOP] | board.pieces[BLACK_BISHOP] |
+                              board.pieces[WHITE_QUEEN] | board.pieces[BLACK_QUEEN];
+    const Bitboard straight = board.pieces[WHITE_ROOK] | board.pieces[BLACK_ROOK] |
+                              board.pieces[WHITE_QUEEN] | board.pieces[BLACK_QUEEN];
+    int gain[33];
+    int depth = 0;
+    Bitboard occupied = board.occupied;
+    Bitboard attackers = attackers_to(board, to, occupied);
+    Bitboard fromBB = square_bb(from);
+    Piece attacker = board.squares[from];
+    bool white = is_white(attacker);
+    gain[0] = piece_values[board.squares[to]];
+
+    while (fromBB) {
+        ++depth;
+        gain[depth] = piece_values[attacker] - gain[depth - 1];
+        if (max(-gain[depth - 1], gain[depth]) < 0) break;  // neither side wants to go on
+
+        occupied ^= fromBB;
+        attackers |= (bishop_attacks(to, occupied) & diagonal) | (rook_attacks(to, occupied) & straight);
+        attackers &= occupied;
+
+        white = !white;
+        fromBB = 0;
+        const Piece first = white ? WHITE_PAWN : BLACK_PAWN;
+        for (int kind = 0; kind < 6; ++kind) {
+            Bitboard candidates = attackers & board.pieces[first + kind];
+            if (candidates) {
+                fromBB = candidates & (0 - candidates);
+                attacker = Piece(first + kind);
+                break;
+            }
+        }
+    }
+    while (--depth > 0) gain[depth - 1] = -max(-gain[depth - 1], gain[depth]);
+    return gain[0];
+}
+
+LegalityInfo legality_info(const Position& board, bool isWhiteTurn) {
+    LegalityInfo info{board.kingSquare[isWhiteTurn ? WHITE : BLACK], 0, 0, ~0ULL};
+    if (info.king < 0) return info;
+
+    const Piece enemyFirst = isWhiteTurn ? BLACK_PAWN : WHITE_PAWN;
+    const Bitboard own = board.byColor[isWhiteTurn ? WHITE : BLACK];
+    const Bitboard enemy = board.byColor[isWhiteTurn ? BLACK : WHITE];
+    info.checkers = attackers_to(board, info.king, board.occupied) & enemy;
+
+    // Enemy sliders that would see the king through our pieces pin the one
+    // piece standing in between
+    const Bitboard queens = board.pieces[enemyFirst + 4];
+    Bitboard snipers = (bishop_attacks(info.king, enemy) & (board.pieces[enemyFirst + 2] | queens)) |
+                       (rook_attacks(info.king, enemy) & (board.pieces[enemyFirst + 3] | queens));
+    while (snipers) {
+        Bitboard blockers = between_bb[info.king][pop_lsb(snipers)] & board.occupied;
+        if (popcount(blockers) == 1 && (blockers & own)) info.pinned |= blockers;
+    }
+
+    if (info.checkers) {
+        info.evasions = popcount(info.checkers) > 1
+            ? 0  // double check: only the king can move
+            : info.checkers | between_bb[info.king][lsb(info.checkers)];
+    }
+    return info;
+}
+
+template <typename MoveSink>
+void add_promotions(MoveSink& moves, int from, int to) {
+    for (uint8_t flag : {PROMOTE_QUEEN, PROMOTE_KNIGHT, PROMOTE_ROOK, PROMOTE_BISHOP}) {
+        moves.push_back(Move(from, to, flag));
+    }
+}
+
+// Appends the legal moves of the requested type for pieces on fromMask.
+// Pinned pieces stay on their pin line, other pieces must land on an
+// evasion square, and the king never steps onto an attacked square.
+template <typename MoveSink>
+void generate_legal(const Position& board, bool isWhiteTurn, const LegalityInfo& info, GenType type,
+                    MoveSink& moves, Bitboard fromMask) {
+    const Color us = isWhiteTurn ? WHITE : BLACK;
+    const Bitboard own = board.byColor[us];
+    const Bitboard enemy = board.byColor[isWhiteTurn ? BLACK : WHITE];
+    const Bitboard empty = ~board.occupied;
+    const Piece firstPiece = isWhiteTurn ? WHITE_PAWN : BLACK_PAWN;
+    const Bitboard targetMask = type == GEN_CAPTURES ? enemy : type == GEN_QUIETS ? empty : ~own;
+
+    if (info.king >= 0 && (fromMask & square_bb(info.king))) {
+        const int king = info.king;
+        const Bitboard withoutKing = board.occupied ^ square_bb(king);
+        Bitboard targets = king_attacks[king] & targetMask;
+        while (targets) {
+            int to = pop_lsb(targets);
+            if (!(attackers_to(board, to, withoutKing) & enemy)) {
+                moves.push_back(Move(king, to));
+            }
+        }
+
+        // Castling: rights left, rook at home, nothing in between, and the
+        // king neither in check nor passing over or landing on an attacked square
+        if (type != GEN_CAPTURES && !info.checkers && king == (isWhiteTurn ? 60 : 4)) {
+            const uint8_t kingside = isWhiteTurn ? WHITE_KINGSIDE : BLACK_KINGSIDE;
+            const uint8_t queenside = isWhiteTurn ? WHITE_QUEENSIDE : BLACK_QUEENSIDE;
+            const Piece rook = Piece(firstPiece + 3);
+            if ((board.castling & kingside) && board.squares[king + 3] == rook &&
+                !(board.occupied & (square_bb(king + 1) | square_bb(king + 2))) &&
+                !is_square_attacked(board, king + 1, !isWhiteTurn) &&
+                !is_square_attacked(board, king + 2, !isWhiteTurn)) {
+                moves.push_back(Move(king, king + 2, CASTLING));
+            }
+            if ((board.castling & queenside) && board.squares[king - 4] == rook &&
+                !(board.occupied & (square_bb(king - 1) | square_bb(king - 2) | square_bb(king - 3))) &&
+                !is_square_attacked(board, king - 1, !isWhiteTurn) &&
+                !is_square_attacked(board, king - 2, !isWhiteTurn)) {
+                moves.push_back(Move(king, king - 2, CASTLING));
+            }
+        }
+    }
+    if (!info.evasions) return;
+
+    // Pawns: pushes are quiet except promotions, which count as captures
+    const int direction = isWhiteTurn ? -8 : 8;
+    const int startRow = isWhiteTurn ? 6 : 1;
+    const int promotionRow = isWhiteTurn ? 0 : 7;
+    Bitboard pawns = board.pieces[firstPiece] & fromMask;
+    while (pawns) {
+        const int from = pop_lsb(pawns);
+        const Bitboard pinLine = (info.pinned & square_bb(from)) ? line_bb[info.king][from] : ~0ULL;
+        const Bitboard allowed = pinLine & info.evasions;
+        const int to = from + direction;
+        if (to < 0 || to >= 64) continue;
+        const bool promotes = row_of(to) == promotionRow;
+
+        if (empty & square_bb(to)) {
+            if (promotes) {
+                if (type != GEN_QUIETS && (allowed & square_bb(to))) add_promotions(moves, from, to);
+            } else if (type != GEN_CAPTURES) {
+                if (allowed & square_bb(to)) add_moves(moves, from, square_bb(to));
+                const int twoSteps = to + direction;
+                if (row_of(from) == startRow && (empty & square_bb(twoSteps)) && (allowed & square_bb(twoSteps))) {
+                    add_moves(moves, from, square_bb(twoSteps));
+                }
+            }
+        }
+        if (type == GEN_QUIETS) continue;
+
+        Bitboard captures = pawn_attacks[us][from] & enemy & allowed;
+        while (captures) {
+            int target = pop_lsb(captures);
+            if (promotes) add_promotions(moves, from, target);
+            else add_moves(moves, from, square_bb(target));
+        }
+
+        // En passant removes two pawns from the board at once, so it is
+        // checked by replaying the occupancy rather than with the masks
+        if (board.epSquare >= 0 && (pawn_attacks[us][from] & square_bb(board.epSquare))) {
+            const int victim = square_of(row_of(from), col_of(board.epSquare));
+            const Bitboard after = (board.occupied ^ square_bb(from) ^ square_bb(victim)) | square_bb(board.epSquare);
+            if (info.king < 0 || !(attackers_to(board, info.king, after) & enemy & ~square_bb(victim))) {
+                moves.push_back(Move(from, board.epSquare, EN_PASSANT));
+            }
+        }
+    }
+
+    for (int kind = 1; kind < 5; ++kind) {
+        const Piece piece = Piece(firstPiece + kind);
+        Bitboard bb = board.pieces[piece] & fromMask;
+        while (bb) {
+            const int from = pop_lsb(bb);
+            Bitboard targets = piece_attacks(piece, from, board.occupied) & targetMask & info.evasions;
+            if (info.pinned & square_bb(from)) targets &= line_bb[info.king][from];
+            add_moves(moves, from, targets);
+        }
+    }
+}
+
+MoveList generate_moves(const Position& board, bool isWhiteTurn) {
+    MoveList moves;
+    generate_legal(board, isWhiteTurn, legality_info(board, isWhiteTurn), GEN_ALL, moves);
+    return moves;
+}
+
+struct MoveCounter {
+    int count = 0;
+    void push_back(const Move&) { ++count; }
+};
+
+int count_legal_moves(const Position& board, bool isWhiteTurn) {
+    MoveCounter counter;
+    generate_legal(board, isWhiteTurn, legality_info(board, isWhiteTurn), GEN_ALL, counter);
+    return counter.count;
+}
+
+// Captures and promotions, sorted for the quiescence search and the move
+// picker: most valuable victim first, promotions to a queen ahead of that.
+// Lists are short, so an insertion sort on the side array of keys does.
+void generate_captures(const Position& board, bool isWhiteTurn, const LegalityInfo& info, MoveList& moves) {
+    generate_legal(board, isWhiteTurn, info, GEN_CAPTURES, moves);
+    int scores[MAX_MOVES];
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = moves[i];
+        const Piece attacker = board.squares[move.from()];
+        const Piece victim = move.flags() == EN_PASSANT ? Piece(WHITE_PAWN) : board.squares[move.to()];
+        const int score = (victim != EMPTY ? mvv_lva(victim, attacker) : 0) + (move.flags() == PROMOTE_QUEEN ? 64 : 0);
+        int j = i;
+        for (; j > 0 && scores[j - 1] < score; --j) {
+            scores[j] = scores[j - 1];
+            moves[j] = moves[j - 1];
+        }
+        scores[j] = score;
+        moves[j] = move;
+    }
+}
+
+// Only records whether the generator produced a given move
+struct MoveFinder {
+    Move target;
+    bool found = false;
+    void push_back(const Move& move) { found |= move == target; }
+};
+
+bool is_legal(const Position& board, bool isWhiteTurn, const LegalityInfo& info, const Move& move) {
+    const Piece piece = board.squares[move.from()];
+    if (piece == EMPTY || is_white(piece) != isWhiteTurn) return false;
+
+    MoveFinder finder{move};
+    generate_legal(board, isWhiteTurn, info, GEN_ALL, finder, square_bb(move.from()));
+    return finder.found;
+}
+
+string move_to_uci(const Move& move) {
+    string text = {char('a' + col_of(move.from())), char('8' - row_of(move.from())),
+                   char('a' + col_of(move.to())), char('8' - row_of(move.to()))};
+    if (is_promotion(move)) text += "nbrq"[move.flags() - PROMOTE_KNIGHT];
+    return text;
+}
+
+bool is_checkmate(const Position& board, bool isWhiteTurn) {
+    return is_king_in_check(board, isWhiteTurn) && count_legal_moves(board, isWhiteTurn) == 0;
+}
+
+bool is_stalemate(const Position& board, bool isWhiteTurn) {
+    return !is_king_in_check(board, isWhiteTurn) && count_legal_moves(board, isWhiteTurn) == 0;
+}
+
+// The only sink other translation units use
+template void generate_legal<MoveList>(const Position&, bool, const LegalityInfo&, GenType, MoveList&, Bitboard);
@@ -0,0 +1,80 @@
+// Legal move generation and the attack queries it is built on
+#ifndef CHESSAI_MOVEGEN_H
+#define CHESSAI_MOVEGEN_H
+
+#include <string>
+
+#include "position.h"
+
+// Squares a piece standing on sq attacks (pawns: diagonal captures only)
+Bitboard piece_attacks(Piece piece, int sq, Bitboard occupied);
+
+// Pieces of both colours attacking sq, given the occupancy (sliders see
+// through anything removed from occupied)
+Bitboard attackers_to(const Position& board, int sq, Bitboard occupied);
+
+// Whether any piece of the given side attacks sq
+bool is_square_attacked(const Position& board, int sq, bool byWhite);
+
+// Static exchange evaluation of a capture; only the sign is exact
+int see(const Position& board, const Move& move);
+
+// Most valuable victim first, least valuable attacker second
+inline int mvv_lva(Piece victim, Piece attacker) {
+    return (victim - WHITE_PAWN) % 6 * 8 + 5 - (attacker - WHITE_PAWN) % 6;
+}
+
+inline bool is_king_in_check(const Position& board, bool isWhiteKing) {
+    int kingSquare = board.kingSquare[isWhiteKing ? WHITE : BLACK];
+    if (kingSquare < 0) return false;
+    return is_square_attacked(board, kingSquare, !isWhiteKing);
+}
+
+// Check and pin state of the side to move, computed once per node so the
+// generator can emit legal moves without trying them on the board
+struct LegalityInfo {
+    int king;           // -1 in a position without our king
+    Bitboard checkers;  // enemy pieces giving check
+    Bitboard pinned;    // own pieces that may only move along the line to the king
+    Bitboard evasions;  // where a non-king move must land: the checker or between it
+                        // and the king; every square when not in check
+};
+
+LegalityInfo legality_info(const Position& board, bool isWhiteTurn);
+
+// Captures here means every move that changes material: captures, en
+// passant and all promotions. Quiets are everything else, castling included.
+enum GenType { GEN_CAPTURES, GEN_QUIETS, GEN_ALL };
+
+// Appends the legal moves of the requested type for pieces on fromMask to
+// a sink with a push_back(Move) member. Instantiated in movegen.cpp for
+// MoveList; other sinks stay private to it.
+template <typename MoveSink>
+void generate_legal(const Position& board, bool isWhiteTurn, const LegalityInfo& info, GenType type,
+                    MoveSink& moves, Bitboard fromMask = ~0ULL);
+
+MoveList generate_moves(const Position& board, bool isWhiteTurn);
+
+// Number of legal moves, without building the list
+int count_legal_moves(const Position& board, bool isWhiteTurn);
+
+// Captures and promotions, best first: most valuable victim, with
+// promotions to a queen ahead of that
+void generate_captures(const Position& board, bool isWhiteTurn, const LegalityInfo& info, MoveList& moves);
+
+// Whether a move from a table (hash move, killer) is legal here; the
+// entry may come from another position
+bool is_legal(const Position& board, bool isWhiteTurn, const LegalityInfo& info, const Move& move);
+
+// Quiet moves are the ones killers, history and countermoves learn from
+inline bool is_quiet(const Position& board, const Move& move) {
+    return board.squares[move.to()] == EMPTY && (move.flags() == NORMAL_MOVE || move.flags() == CASTLING);
+}
+
+// Coordinate notation: e2e4, e7e8q
+std::string move_to_uci(const Move& move);
+
+bool is_checkmate(const Position& board, bool isWhiteTurn);
+bool is_stalemate(const Position& board, bool isWhiteTurn);
+
+#endif  // CHESSAI_MOVEGEN_H
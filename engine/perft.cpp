@@ -0,0 +1,163 @@
+#include "perft.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "eval.h"
+#include "search.h"
+
+using namespace std;
+
+PerftTable perft_table;
+
+// Bulk counting: the last ply only counts the legal moves, so leaf moves
+// are neither stored nor played
+uint64_t perft(Position& board, int depth, bool isWhiteTurn) {
+    if (depth == 0) return 1;
+    uint64_t key = position_key(board, isWhiteTurn);
+    uint64_t nodes = 0;
+    if (depth > 1 && perft_table.enabled() && perft_table.probe(key, depth, nodes)) return nodes;
+
+    if (depth == 1) return count_legal_moves(board, isWhiteTurn);
+    for (const Move& move : generate_moves(board, isWhiteTurn)) {
+        UndoInfo undo;
+        board.make_move(move, undo);
+        nodes += perft(board, depth - 1, !isWhiteTurn);
+        board.unmake_move(move, undo);
+    }
+    if (perft_table.enabled()) perft_table.store(key, depth, nodes);
+    return nodes;
+}
+
+uint64_t perft_root(const Position& board, int depth, bool isWhiteTurn, bool divide) {
+    auto start = chrono::steady_clock::now();
+    MoveList moves = generate_moves(board, isWhiteTurn);
+    vector<uint64_t> counts(moves.size(), 0);
+    uint64_t total = depth <= 0 ? 1 : 0;
+    if (depth > 0) {
+        TaskGroup group;
+        for (int i = 0; i < moves.size(); ++i) {
+            search_pool.submit(group, [&, i] {
+                Position local = board;
+                UndoInfo undo;
+                local.make_move(moves[i], undo);
+                counts[i] = perft(local, depth - 1, !isWhiteTurn);
+            });
+        }
+        search_pool.wait(group);
+        for (int i = 0; i < moves.size(); ++i) {
+            if (divide) cout << move_to_uci(moves[i]) << ": " << counts[i] << endl;
+            total += counts[i];
+        }
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "perft " << depth << ": " << total << " nodes in " << seconds << "s ("
+         << uint64_t(total / max(seconds, 1e-9)) << " nodes/sec)" << endl;
+    return total;
+}
+
+// Standard perft positions with their known totals
+struct PerftCase {
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+};
+const PerftCase perft_cases[] = {
+    {STARTPOS_FEN, 5, 4865609},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594},
+};
+
+// Returns false if any count in perft_cases is wrong
+bool perft_suite() {
+    bool passed = true;
+    for (const PerftCase& test : perft_cases) {
+        Position board;
+        bool isWhiteTurn = true;
+        board.set_fen(test.fen, isWhiteTurn);
+        cout << test.fen << endl;
+        uint64_t nodes = perft_root(board, test.depth, isWhiteTurn, false);
+        if (nodes != test.nodes) {
+            cout << "FAILED: expected " << test.nodes << endl;
+            passed = false;
+        }
+    }
+    cout << (passed ? "perft suite passed" : "perft suite FAILED") << endl;
+    return passed;
+}
+
+// Times the per-node kernels on one thread over every position up to two
+// plies from the perft positions and prints nanoseconds per call
+void bench_kernels() {
+    vector<Position> positions;
+    vector<bool> sides;
+    for (const PerftCase& test : perft_cases) {
+        Position root;
+        bool isWhiteTurn = true;
+        root.set_fen(test.fen, isWhiteTurn);
+        positions.push_back(root);
+        sides.push_back(isWhiteTurn);
+        for (const Move& move : generate_moves(root, isWhiteTurn)) {
+            Position child = root;
+            UndoInfo undo;
+            child.make_move(move, undo);
+            positions.push_back(child);
+            sides.push_back(!isWhiteTurn);
+            for (const Move& reply : generate_moves(child, !isWhiteTurn)) {
+                Position grandchild = child;
+                grandchild.make_move(reply, undo);
+                positions.push_back(grandchild);
+                sides.push_back(isWhiteTurn);
+            }
+        }
+    }
+
+    const int rounds = 20;
+    auto time_kernel = [&](const char* name, const function<uint64_t(Position&, bool)>& kernel) {
+        uint64_t checksum = 0;
+        auto start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < positions.size(); ++i) checksum += kernel(positions[i], sides[i]);
+        }
+        double nanoseconds = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        cout << name << ": " << nanoseconds / (rounds * positions.size()) << " ns/call (checksum " << checksum
+             << ")" << endl;
+    };
+
+    cout << positions.size() << " positions" << endl;
+    time_kernel("evaluate_board", [](Position& board, bool) { return uint64_t(evaluate_board(board)); });
+    time_kernel("is_king_in_check", [](Position& board, bool side) { return uint64_t(is_king_in_check(board, side)); });
+    time_kernel("legality_info", [](Position& board, bool side) { return legality_info(board, side).pinned; });
+    time_kernel("count_legal_moves", [](Position& board, bool side) { return uint64_t(count_legal_moves(board, side)); });
+    time_kernel("generate_moves", [](Position& board, bool side) { return uint64_t(generate_moves(board, side).size()); });
+
+    // Moves are generated up front so only the make/unmake pairs are timed,
+    // and the time is per move rather than per position
+    vector<MoveList> moveLists;
+    size_t moveCount = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        moveLists.push_back(generate_moves(positions[i], sides[i]));
+        moveCount += moveLists.back().size();
+    }
+    uint64_t keys = 0;
+    auto start = chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < positions.size(); ++i) {
+            for (const Move& move : moveLists[i]) {
+                UndoInfo undo;
+                positions[i].make_move(move, undo);
+                keys += positions[i].key;
+                positions[i].unmake_move(move, undo);
+            }
+        }
+    }
+    double nanoseconds = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    cout << "make+unmake_move: " << nanoseconds / (rounds * max<size_t>(moveCount, 1)) << " ns/move (checksum "
+         << keys << ")" << endl;
+}
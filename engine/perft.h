@@ -0,0 +1,76 @@
+// Perft: counts the leaf nodes of the legal move tree to a fixed depth, to
+// check the move generator against known totals and to time it.
+#ifndef CHESSAI_PERFT_H
+#define CHESSAI_PERFT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "position.h"
+
+// Optional cache of subtree counts keyed by position and remaining depth.
+// Lock-free like the transposition table: the key is stored XORed with the
+// data word, so a probe that races a store misses instead of reading a torn
+// entry. Every store replaces what was in the slot.
+class PerftTable {
+public:
+    // Rounds down to a power-of-two number of entries; 0 disables the table
+    void resize(size_t megabytes) {
+        entries.reset();
+        mask = 0;
+        if (megabytes == 0) return;
+        size_t count = 1;
+        while (count * 2 * sizeof(Entry) <= megabytes << 20) count *= 2;
+        entries.reset(new Entry[count]);
+        mask = count - 1;
+        for (size_t i = 0; i < count; ++i) {
+            entries[i].keyXorData.store(0, std::memory_order_relaxed);
+            entries[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    bool enabled() const { return entries != nullptr; }
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const {
+        const Entry& entry = entries[key & mask];
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        if ((entry.keyXorData.load(std::memory_order_relaxed) ^ data) != key || int(data & 0xFF) != depth) return false;
+        nodes = data >> 8;
+        return true;
+    }
+
+    void store(uint64_t key, int depth, uint64_t nodes) {
+        Entry& entry = entries[key & mask];
+        uint64_t data = nodes << 8 | uint64_t(depth);
+        entry.keyXorData.store(key ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;  // nodes:56 | depth:8
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    size_t mask = 0;
+};
+
+extern PerftTable perft_table;
+
+uint64_t perft(Position& board, int depth, bool isWhiteTurn);
+
+// Counts each root move's subtree as a separate pool task. With divide set,
+// prints every root move's count; always prints the total and nodes/sec.
+uint64_t perft_root(const Position& board, int depth, bool isWhiteTurn, bool divide);
+
+// Runs the standard perft positions; returns false if any count is wrong
+bool perft_suite();
+
+// Times the per-node kernels on one thread and prints nanoseconds per call;
+// make/unmake is timed per move
+void bench_kernels();
+
+#endif  // CHESSAI_PERFT_H
@@ -0,0 +1,280 @@
+#include "position.h"
+#include "movegen.h"
+
+#include <sstream>
+#include <utility>
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+uint64_t zobrist_pieces[13][64];
+uint64_t zobrist_castling[16];
+uint64_t zobrist_en_passant[8];
+uint64_t zobrist_black_to_move;
+
+Bitboard knight_attacks[64];
+Bitboard king_attacks[64];
+Bitboard pawn_attacks[2][64];
+
+// For two squares on a common rank, file or diagonal: the squares strictly
+// between them, and the whole line through them. Empty otherwise.
+Bitboard between_bb[64][64];
+Bitboard line_bb[64][64];
+
+Bitboard leaper_attacks(int square, const pair<int, int>* offsets, int count) {
+    Bitboard attacks = 0;
+    for (int i = 0; i < count; ++i) {
+        int row = row_of(square) + offsets[i].first;
+        int col = col_of(square) + offsets[i].second;
+        if (row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE) {
+            attacks |= square_bb(square_of(row, col));
+        }
+    }
+    return attacks;
+}
+
+// Reference ray walk; only used to build the attack tables at startup
+Bitboard sliding_attacks(int square, Bitboard occupied, const pair<int, int>* directions) {
+    Bitboard attacks = 0;
+    for (int i = 0; i < 4; ++i) {
+        int row = row_of(square) + directions[i].first;
+        int col = col_of(square) + directions[i].second;
+
+        while (row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE) {
+            Bitboard b = square_bb(square_of(row, col));
+            attacks |= b;
+            if (occupied & b) break;
+            row += directions[i].first;
+            col += directions[i].second;
+        }
+    }
+    return attacks;
+}
+
+const pair<int, int> bishop_directions[4] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+const pair<int, int> rook_directions[4] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+Magic bishop_magics[64];
+Magic rook_magics[64];
+Bitboard bishop_attack_table[0x1480];
+Bitboard rook_attack_table[0x19000];
+
+bool use_pext = false;
+
+#ifdef USE_PEXT
+// Kept out of line so the rest of the binary still runs on CPUs without BMI2
+__attribute__((target("bmi2"))) unsigned pext_index(Bitboard occupied, Bitboard mask) {
+    return unsigned(_pext_u64(occupied, mask));
+}
+#endif
+
+// Magic multipliers for this square layout, found offline by a seeded
+// random search over sparse candidates
+const Bitboard bishop_magic_numbers[64] = {
+        0x0208308128002080ULL, 0x0810042080820080ULL, 0xCC4202120420D800ULL, 0x01D1040081120001ULL,
+        0x4064042000600040ULL, 0x020101209124C008ULL, 0x01040A211029C000ULL, 0x0000120101084000ULL,
+        0x8008A12001020080ULL, 0x0000A04101110100ULL, 0x808018320401A108ULL, 0x019004050210021CULL,
+        0x0C64220210000040ULL, 0x8004008804400001ULL, 0x4041020804030800ULL, 0x200500420201A002ULL,
+        0x0040181204010400ULL, 0x0828202045072210ULL, 0x0041003000408101ULL, 0x4008400C04020882ULL,
+        0x0004001088A00010ULL, 0x040E000022100240ULL, 0x000084110C092000ULL, 0x3800214082011002ULL,
+        0x5020840020989200ULL, 0x0201080110708103ULL, 0x1184100402082140ULL, 0x0000808008020002ULL,
+        0x0240802002020040ULL, 0x5808020200405203ULL, 0x01A0810A02080200ULL, 0x4000B20011230403ULL,
+        0x2011200903200805ULL, 0x0014108209081201ULL, 0x00C0108801100042ULL, 0x1000400820020201ULL,
+        0xE091101400028020ULL, 0x0000A80042060100ULL, 0x0108424041008806ULL, 0x00010E0089820440ULL,
+        0x0000B00820140941ULL, 0x0000420220081000ULL, 0x4084140028042C00ULL, 0x0000086018004103ULL,
+        0x1052082008201100ULL, 0x22A0144482200200ULL, 0x2004108086001104ULL, 0x0010020204450022ULL,
+        0x0060411010B18400ULL, 0x0209040104020010ULL, 0xC008120052480408ULL, 0x0000100084110020ULL,
+        0x489E001021024202ULL, 0x000010E021010812ULL, 0x0040044104010080ULL, 0x00049850A1020000ULL,
+        0x000A0A0104110440ULL, 0x0010004048041050ULL, 0x0003008488680800ULL, 0x0821010002104400ULL,
+        0x0800023004504401ULL, 0x0860812004101088ULL, 0x0B00441104011400ULL, 0x0006101009818189ULL
+};
+
+const Bitboard rook_magic_numbers[64] = {
+        0x0A80008010400020ULL, 0x40C0004020001008ULL, 0x2080100020000880ULL, 0x0900100088210004ULL,
+        0x08802C0048008002ULL, 0x0800844010020820ULL, 0x2080808002000100ULL, 0x4200040048802201ULL,
+        0x0018800028400480ULL, 0x2121002081004002ULL, 0x0041805000200082ULL, 0x9085002100100008ULL,
+        0x6841000501100800ULL, 0x0860800200800401ULL, 0x0100808002000100ULL, 0x0202001041008204ULL,
+        0x0000808000400020ULL, 0x1010014000200040ULL, 0x0220044010080040ULL, 0x0002828010008800ULL,
+        0x01A0808004000800ULL, 0x0800808002000400ULL, 0x1020840050020108ULL, 0x004026000114408CULL,
+        0x00C0802080004008ULL, 0x0050004140002000ULL, 0x1000200080100080ULL, 0x0820100080800800ULL,
+        0x4046480280040080ULL, 0x0804000202000810ULL, 0x0001028400081001ULL, 0x4000808200204401ULL,
+        0x1000F0C005800084ULL, 0x08110A0082002040ULL, 0x0410110045002000ULL, 0x8000810804801001ULL,
+        0x4080080101000410ULL, 0x0044008004800200ULL, 0x20A0020001010004ULL, 0x00D0006082001401ULL,
+        0x0060400080088020ULL, 0x0240008020008040ULL, 0x0002402003090010ULL, 0x0001000810010020ULL,
+        0x0C02000820120004ULL, 0x0022000410020008ULL, 0x0000020004010100ULL, 0x010000A400420001ULL,
+        0x5461002080004900ULL, 0x0828401008200040ULL, 0x0000200040110100ULL, 0xC084400920120200ULL,
+        0x8100808400280180ULL, 0x0520040002008080ULL, 0x9002008801040200ULL, 0x0101800061000080ULL,
+        0x1042052100418216ULL, 0x0106018010E24902ULL, 0x1000412813006001ULL, 0x1000040900201001ULL,
+        0x0421000410020801ULL, 0x8802004490080102ULL, 0x0084183043810604ULL, 0x00001402810040A2ULL
+};
+
+void init_magics(Magic* magics, Bitboard* table, const Bitboard* numbers,
+                 const pair<int, int>* directions) {
+    const Bitboard fileA = 0x0101010101010101ULL, fileH = fileA << 7;
+    const Bitboard row0 = 0xFFULL, row7 = row0 << 56;
+
+    for (int square = 0; square < 64; ++square) {
+        // Board edges only matter when the slider stands on them
+        Bitboard edges = ((row0 | row7) & ~(row0 << (8 * row_of(square)))) |
+                         ((fileA | fileH) & ~(fileA << col_of(square)));
+
+        Magic& m = magics[square];
+        m.mask = sliding_attacks(square, 0, directions) & ~edges;
+        m.magic = numbers[square];
+        m.shift = 64 - popcount(m.mask);
+        m.attacks = square == 0 ? table : magics[square - 1].attacks + (1 << (64 - magics[square - 1].shift));
+
+        // Fill the slice for every blocker subset of the mask (Carry-Rippler)
+        Bitboard b = 0;
+        do {
+            m.attacks[magic_index(m, b)] = sliding_attacks(square, b, directions);
+            b = (b - m.mask) & m.mask;
+        } while (b);
+    }
+}
+
+// xorshift64*; a fixed seed keeps hash keys identical between runs
+uint64_t random_u64(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+void init_bitboards() {
+    const pair<int, int> knight_offsets[8] = {
+            {-2, -1}, {-2, 1}, {-1, -2}, {-1, 2},
+            {1, -2}, {1, 2}, {2, -1}, {2, 1}
+    };
+    const pair<int, int> king_offsets[8] = {
+            {-1, -1}, {-1, 0}, {-1, 1}, {0, -1},
+            {0, 1}, {1, -1}, {1, 0}, {1, 1}
+    };
+    const pair<int, int> white_pawn_offsets[2] = {{-1, -1}, {-1, 1}};
+    const pair<int, int> black_pawn_offsets[2] = {{1, -1}, {1, 1}};
+
+    for (int square = 0; square < 64; ++square) {
+        knight_attacks[square] = leaper_attacks(square, knight_offsets, 8);
+        king_attacks[square] = leaper_attacks(square, king_offsets, 8);
+        pawn_attacks[WHITE][square] = leaper_attacks(square, white_pawn_offsets, 2);
+        pawn_attacks[BLACK][square] = leaper_attacks(square, black_pawn_offsets, 2);
+    }
+
+#ifdef USE_PEXT
+    use_pext = __builtin_cpu_supports("bmi2");
+#endif
+    init_magics(bishop_magics, bishop_attack_table, bishop_magic_numbers, bishop_directions);
+    init_magics(rook_magics, rook_attack_table, rook_magic_numbers, rook_directions);
+
+    for (int a = 0; a < 64; ++a) {
+        for (int b = 0; b < 64; ++b) {
+            if (a == b) continue;
+            if (bishop_attacks(a, 0) & square_bb(b)) {
+                line_bb[a][b] = (bishop_attacks(a, 0) & bishop_attacks(b, 0)) | square_bb(a) | square_bb(b);
+                between_bb[a][b] = bishop_attacks(a, square_bb(b)) & bishop_attacks(b, square_bb(a));
+            } else if (rook_attacks(a, 0) & square_bb(b)) {
+                line_bb[a][b] = (rook_attacks(a, 0) & rook_attacks(b, 0)) | square_bb(a) | square_bb(b);
+                between_bb[a][b] = rook_attacks(a, square_bb(b)) & rook_attacks(b, square_bb(a));
+            }
+        }
+    }
+
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (int p = WHITE_PAWN; p <= BLACK_KING; ++p) {
+        for (int square = 0; square < 64; ++square) {
+            zobrist_pieces[p][square] = random_u64(seed);
+        }
+    }
+    zobrist_black_to_move = random_u64(seed);
+    for (auto& key : zobrist_castling) key = random_u64(seed);
+    zobrist_castling[0] = 0;  // so a cleared Position hashes to zero
+    for (auto& key : zobrist_en_passant) key = random_u64(seed);
+}
+
+bool Position::set_fen(const string& fen, bool& isWhiteTurn) {
+    static const string pieceChars = " PNBRQKpnbrqk";
+    istringstream in(fen);
+    string placement, side, rights = "-", ep = "-";
+    int halfmoves = 0, fullmoves = 1;
+    if (!(in >> placement >> side)) return false;
+    in >> rights >> ep >> halfmoves >> fullmoves;
+
+    clear();
+    int row = 0, col = 0, whiteKings = 0, blackKings = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            // Each of the eight ranks must cover exactly eight squares
+            if (col != BOARD_SIZE || ++row == BOARD_SIZE) return false;
+            col = 0;
+            continue;
+        }
+        if (c >= '1' && c <= '8') {
+            col += c - '0';
+            if (col > BOARD_SIZE) return false;
+            continue;
+        }
+        size_t piece = pieceChars.find(c);
+        if (piece == string::npos || piece == EMPTY || col >= BOARD_SIZE) return false;
+        if (piece == WHITE_KING) ++whiteKings;
+        if (piece == BLACK_KING) ++blackKings;
+        put_piece(Piece(piece), square_of(row, col++));
+    }
+    if (row != BOARD_SIZE - 1 || col != BOARD_SIZE || (side != "w" && side != "b")) return false;
+    isWhiteTurn = side == "w";
+    // One king a side, and the side that just moved cannot be in check
+    if (whiteKings != 1 || blackKings != 1 || is_king_in_check(*this, !isWhiteTurn)) return false;
+
+    uint8_t available = 0;
+    for (char c : rights) {
+        if (c == 'K' && squares[60] == WHITE_KING && squares[63] == WHITE_ROOK) available |= WHITE_KINGSIDE;
+        if (c == 'Q' && squares[60] == WHITE_KING && squares[56] == WHITE_ROOK) available |= WHITE_QUEENSIDE;
+        if (c == 'k' && squares[4] == BLACK_KING && squares[7] == BLACK_ROOK) available |= BLACK_KINGSIDE;
+        if (c == 'q' && squares[4] == BLACK_KING && squares[0] == BLACK_ROOK) available |= BLACK_QUEENSIDE;
+    }
+    set_castling(available);
+
+    if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] == (isWhiteTurn ? '6' : '3')) {
+        int col = ep[0] - 'a';
+        int pawnRow = isWhiteTurn ? 3 : 4;
+        if (at(pawnRow, col) == (isWhiteTurn ? BLACK_PAWN : WHITE_PAWN)) {
+            set_ep_square(square_of(isWhiteTurn ? 2 : 5, col));
+        }
+    }
+    halfmoveClock = max(halfmoves, 0);
+    fullmoveNumber = max(fullmoves, 1);
+    return true;
+}
+
+string Position::to_fen(bool isWhiteTurn) const {
+    static const char pieceChars[] = " PNBRQKpnbrqk";
+    string fen;
+    for (int row = 0; row < BOARD_SIZE; ++row) {
+        int empty = 0;
+        for (int col = 0; col < BOARD_SIZE; ++col) {
+            Piece p = at(row, col);
+            if (p == EMPTY) {
+                ++empty;
+                continue;
+            }
+            if (empty) fen += char('0' + empty);
+            empty = 0;
+            fen += pieceChars[p];
+        }
+        if (empty) fen += char('0' + empty);
+        if (row < BOARD_SIZE - 1) fen += '/';
+    }
+
+    fen += isWhiteTurn ? " w " : " b ";
+    if (castling & WHITE_KINGSIDE) fen += 'K';
+    if (castling & WHITE_QUEENSIDE) fen += 'Q';
+    if (castling & BLACK_KINGSIDE) fen += 'k';
+    if (castling & BLACK_QUEENSIDE) fen += 'q';
+    if (!castling) fen += '-';
+
+    fen += ' ';
+    if (epSquare >= 0) fen += {char('a' + col_of(epSquare)), char('8' - row_of(epSquare))};
+    else fen += '-';
+    return fen + " " + to_string(halfmoveClock) + " " + to_string(fullmoveNumber);
+}
@@ -0,0 +1,382 @@
+// Board representation shared by every part of the engine: pieces, packed
+// moves, bitboard helpers, Zobrist keys, the precomputed attack tables and
+// Position itself. init_bitboards must run before any of it is used.
+#ifndef CHESSAI_POSITION_H
+#define CHESSAI_POSITION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+
+#define BOARD_SIZE 8
+#define MAX_MOVES 256
+#define STARTPOS_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+// Chess pieces enum
+enum Piece : uint8_t {
+    EMPTY,
+    WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING,
+    BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING
+};
+
+// Moves that need more than lifting one piece and dropping it elsewhere
+enum MoveFlag : uint8_t {
+    NORMAL_MOVE, PROMOTE_KNIGHT, PROMOTE_BISHOP, PROMOTE_ROOK, PROMOTE_QUEEN, EN_PASSANT, CASTLING
+};
+
+// A move packed into 16 bits: from | to << 6 | flags << 12, with squares
+// indexed row * 8 + col like Position. The all-zero move (a8 to a8) never
+// occurs in play and stands for "no move". Default construction leaves it
+// uninitialised so move lists cost nothing to set up.
+struct Move {
+    uint16_t data;
+
+    Move() = default;
+    constexpr Move(int from, int to, uint8_t flags = NORMAL_MOVE) : data(uint16_t(from | to << 6 | flags << 12)) {}
+    constexpr explicit Move(uint16_t packed) : data(packed) {}
+
+    int from() const { return data & 63; }
+    int to() const { return (data >> 6) & 63; }
+    uint8_t flags() const { return uint8_t(data >> 12); }
+    bool operator==(const Move& other) const { return data == other.data; }
+    bool operator!=(const Move& other) const { return data != other.data; }
+};
+
+constexpr Move MOVE_NONE(uint16_t(0));
+
+// Legal moves of a position, stored inline: no position has more than 218
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int count = 0;
+
+    void push_back(const Move& move) { moves[count++] = move; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    Move& operator[](int i) { return moves[i]; }
+    const Move& operator[](int i) const { return moves[i]; }
+    Move& front() { return moves[0]; }
+    Move* begin() { return moves; }
+    Move* end() { return moves + count; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+};
+
+inline bool is_white(Piece p) {
+    return p >= WHITE_PAWN && p <= WHITE_KING;
+}
+
+inline bool is_black(Piece p) {
+    return p >= BLACK_PAWN && p <= BLACK_KING;
+}
+
+enum Color { WHITE, BLACK };
+
+inline bool is_promotion(const Move& move) {
+    return move.flags() >= PROMOTE_KNIGHT && move.flags() <= PROMOTE_QUEEN;
+}
+
+inline Piece promotion_piece(uint8_t flags, bool isWhite) {
+    return Piece((isWhite ? WHITE_KNIGHT : BLACK_KNIGHT) + flags - PROMOTE_KNIGHT);
+}
+
+enum CastlingRight : uint8_t {
+    WHITE_KINGSIDE = 1, WHITE_QUEENSIDE = 2, BLACK_KINGSIDE = 4, BLACK_QUEENSIDE = 8, ALL_CASTLING = 15
+};
+
+// Castling rights that survive a move from or to sq: moving a king or a
+// rook off its home square, or capturing the rook there, drops them
+inline uint8_t castling_kept(int sq) {
+    switch (sq) {
+        case 60: return ALL_CASTLING & ~(WHITE_KINGSIDE | WHITE_QUEENSIDE);
+        case 63: return ALL_CASTLING & ~WHITE_KINGSIDE;
+        case 56: return ALL_CASTLING & ~WHITE_QUEENSIDE;
+        case 4: return ALL_CASTLING & ~(BLACK_KINGSIDE | BLACK_QUEENSIDE);
+        case 7: return ALL_CASTLING & ~BLACK_KINGSIDE;
+        case 0: return ALL_CASTLING & ~BLACK_QUEENSIDE;
+        default: return ALL_CASTLING;
+    }
+}
+
+typedef uint64_t Bitboard;
+
+inline int square_of(int row, int col) { return row * BOARD_SIZE + col; }
+inline int row_of(int square) { return square >> 3; }
+inline int col_of(int square) { return square & 7; }
+inline Bitboard square_bb(int square) { return 1ULL << square; }
+inline int popcount(Bitboard b) { return __builtin_popcountll(b); }
+inline int lsb(Bitboard b) { return __builtin_ctzll(b); }
+
+inline int pop_lsb(Bitboard& b) {
+    int square = lsb(b);
+    b &= b - 1;
+    return square;
+}
+
+
+inline bool is_valid_position(int row, int col) {
+    return row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE;
+}
+
+// Zobrist keys: one random number per (piece, square), per set of castling
+// rights and per en passant file, plus one that is mixed in when black is
+// to move. Filled by init_bitboards.
+extern uint64_t zobrist_pieces[13][64];
+extern uint64_t zobrist_castling[16];
+extern uint64_t zobrist_en_passant[8];
+extern uint64_t zobrist_black_to_move;
+
+// Evaluation terms Position keeps summed as pieces move (eval.cpp)
+extern const int piece_values[13];
+extern const int* const piece_tables[13];
+extern const int king_endgame_table[64];
+extern const int phase_values[13];
+
+// Everything make_move overwrites that unmake_move cannot recompute
+struct UndoInfo {
+    Piece captured;
+    uint8_t castling;
+    int epSquare;
+    int halfmoveClock;
+    uint64_t key;
+};
+
+// Board state as twelve piece bitboards plus occupancy masks.
+// Squares are indexed row * 8 + col (a8 = 0, h1 = 63), the same layout
+// the piece-square tables use, and a mailbox gives O(1) piece lookup.
+struct Position {
+    Bitboard pieces[13];  // indexed by Piece; pieces[EMPTY] stays zero
+    Bitboard byColor[2];
+    Bitboard occupied;
+    Piece squares[64];
+    uint64_t key;  // Zobrist hash of pieces, castling rights and en passant square
+    int kingSquare[2];  // by Color, -1 when the side has no king
+    uint8_t castling;   // CastlingRight bits still available
+    int epSquare;       // square a pawn just skipped over, or -1
+    int halfmoveClock;  // plies since the last capture or pawn move
+    int fullmoveNumber; // starts at 1, counted up after each black move
+    // Evaluation sums from white's point of view, kept by put/remove_piece
+    int material;
+    int psqtMiddlegame, psqtEndgame;  // piece-square bonuses; only the king tables differ
+    int phaseMaterial;                // phase_values of both sides
+
+    Position() { clear(); }
+
+    void clear() {
+        std::fill(std::begin(pieces), std::end(pieces), 0);
+        byColor[WHITE] = byColor[BLACK] = 0;
+        occupied = 0;
+        std::fill(std::begin(squares), std::end(squares), EMPTY);
+        kingSquare[WHITE] = kingSquare[BLACK] = -1;
+        castling = 0;
+        epSquare = -1;
+        halfmoveClock = 0;
+        fullmoveNumber = 1;
+        key = 0;
+        material = psqtMiddlegame = psqtEndgame = phaseMaterial = 0;
+    }
+
+    void set_castling(uint8_t rights) {
+        key ^= zobrist_castling[castling] ^ zobrist_castling[rights];
+        castling = rights;
+    }
+
+    void set_ep_square(int square) {
+        if (epSquare >= 0) key ^= zobrist_en_passant[col_of(epSquare)];
+        epSquare = square;
+        if (epSquare >= 0) key ^= zobrist_en_passant[col_of(epSquare)];
+    }
+
+    Piece at(int row, int col) const { return squares[square_of(row, col)]; }
+
+    // Loads a FEN string. The castling, en passant and move counter fields
+    // may be left out. Castling rights without the king and rook at home,
+    // and en passant squares without a pawn to capture, are dropped. Returns
+    // false, leaving the position unusable, if it is malformed: a rank not
+    // eight squares wide, a side without exactly one king, or the side not
+    // to move in check.
+    bool set_fen(const std::string& fen, bool& isWhiteTurn);
+
+    // FEN of this position with the given side to move
+    std::string to_fen(bool isWhiteTurn) const;
+
+    void put_piece(Piece p, int square) {
+        Bitboard b = square_bb(square);
+        squares[square] = p;
+        pieces[p] |= b;
+        byColor[is_white(p) ? WHITE : BLACK] |= b;
+        occupied |= b;
+        key ^= zobrist_pieces[p][square];
+        if (p == WHITE_KING || p == BLACK_KING) kingSquare[is_white(p) ? WHITE : BLACK] = square;
+        update_eval(p, square, 1);
+    }
+
+    void remove_piece(int square) {
+        Piece p = squares[square];
+        if (p == EMPTY) return;
+        Bitboard b = square_bb(square);
+        squares[square] = EMPTY;
+        pieces[p] &= ~b;
+        byColor[is_white(p) ? WHITE : BLACK] &= ~b;
+        occupied &= ~b;
+        key ^= zobrist_pieces[p][square];
+        if (p == WHITE_KING || p == BLACK_KING) kingSquare[is_white(p) ? WHITE : BLACK] = -1;
+        update_eval(p, square, -1);
+    }
+
+    // Adds (delta 1) or takes away (delta -1) a piece's evaluation terms.
+    // Tables are written from white's point of view; rows are mirrored for black.
+    void update_eval(Piece p, int square, int delta) {
+        const bool white = is_white(p);
+        const int sign = white ? delta : -delta;
+        const int tableSquare = white ? square : square ^ 56;
+        const int bonus = piece_tables[p][tableSquare];
+        material += sign * piece_values[p];
+        psqtMiddlegame += sign * bonus;
+        psqtEndgame += sign * (p == WHITE_KING || p == BLACK_KING ? king_endgame_table[tableSquare] : bonus);
+        phaseMaterial += delta * phase_values[p];
+    }
+
+    // Moves whatever stands on 'from' to 'to', capturing anything there
+    void move_piece(int from, int to) {
+        Piece p = squares[from];
+        remove_piece(to);
+        remove_piece(from);
+        put_piece(p, to);
+    }
+
+    // Plays a move in place; pass the same record back to unmake_move
+    void make_move(const Move& move, UndoInfo& undo) {
+        const int from = move.from(), to = move.to();
+        const Piece piece = squares[from];
+        undo.captured = squares[to];
+        undo.castling = castling;
+        undo.epSquare = epSquare;
+        undo.halfmoveClock = halfmoveClock;
+        undo.key = key;
+        set_ep_square(-1);
+
+        switch (move.flags()) {
+            case NORMAL_MOVE:
+                move_piece(from, to);
+                if ((piece == WHITE_PAWN || piece == BLACK_PAWN) && std::abs(to - from) == 16) {
+                    set_ep_square((from + to) / 2);
+                }
+                break;
+            case EN_PASSANT: {
+                // The captured pawn stands beside the mover, not on 'to'
+                int victim = square_of(row_of(from), col_of(to));
+                undo.captured = squares[victim];
+                remove_piece(victim);
+                move_piece(from, to);
+                break;
+            }
+            case CASTLING:
+                // The rook lands on the square the king passed over
+                move_piece(from, to);
+                if (to > from) move_piece(to + 1, to - 1);
+                else move_piece(to - 2, to + 1);
+                break;
+            default:
+                remove_piece(from);
+                remove_piece(to);
+                put_piece(promotion_piece(move.flags(), is_white(piece)), to);
+                break;
+        }
+        set_castling(castling & castling_kept(from) & castling_kept(to));
+        const bool resetsClock = piece == WHITE_PAWN || piece == BLACK_PAWN || undo.captured != EMPTY;
+        halfmoveClock = resetsClock ? 0 : halfmoveClock + 1;
+        if (is_black(piece)) ++fullmoveNumber;
+    }
+
+    void unmake_move(const Move& move, const UndoInfo& undo) {
+        const int from = move.from(), to = move.to();
+        switch (move.flags()) {
+            case NORMAL_MOVE:
+                move_piece(to, from);
+                if (undo.captured != EMPTY) put_piece(undo.captured, to);
+                break;
+            case EN_PASSANT:
+                move_piece(to, from);
+                put_piece(undo.captured, square_of(row_of(from), col_of(to)));
+                break;
+            case CASTLING:
+                if (to > from) move_piece(to - 1, to + 1);
+                else move_piece(to + 1, to - 2);
+                move_piece(to, from);
+                break;
+            default: {
+                Piece pawn = is_white(squares[to]) ? WHITE_PAWN : BLACK_PAWN;
+                remove_piece(to);
+                put_piece(pawn, from);
+                if (undo.captured != EMPTY) put_piece(undo.captured, to);
+                break;
+            }
+        }
+        castling = undo.castling;
+        epSquare = undo.epSquare;
+        halfmoveClock = undo.halfmoveClock;
+        if (is_black(squares[from])) --fullmoveNumber;
+        key = undo.key;
+    }
+};
+
+// Side to move is not part of Position, so it is mixed in here
+inline uint64_t position_key(const Position& board, bool isWhiteTurn) {
+    return isWhiteTurn ? board.key : board.key ^ zobrist_black_to_move;
+}
+
+extern Bitboard knight_attacks[64];
+extern Bitboard king_attacks[64];
+extern Bitboard pawn_attacks[2][64];
+
+// For two squares on a common rank, file or diagonal: the squares strictly
+// between them, and the whole line through them. Empty otherwise.
+extern Bitboard between_bb[64][64];
+extern Bitboard line_bb[64][64];
+
+// Fancy magic bitboards: each square owns a slice of a shared attack table,
+// indexed by multiplying the relevant blockers by a magic number.
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard* attacks;
+    int shift;
+};
+
+extern Magic bishop_magics[64];
+extern Magic rook_magics[64];
+
+// Set when built with USE_PEXT and the CPU reports BMI2
+extern bool use_pext;
+
+#ifdef USE_PEXT
+unsigned pext_index(Bitboard occupied, Bitboard mask);
+#endif
+
+inline unsigned magic_index(const Magic& m, Bitboard occupied) {
+#ifdef USE_PEXT
+    if (use_pext) return pext_index(occupied, m.mask);
+#endif
+    return unsigned(((occupied & m.mask) * m.magic) >> m.shift);
+}
+
+inline Bitboard bishop_attacks(int square, Bitboard occupied) {
+    const Magic& m = bishop_magics[square];
+    return m.attacks[magic_index(m, occupied)];
+}
+
+inline Bitboard rook_attacks(int square, Bitboard occupied) {
+    const Magic& m = rook_magics[square];
+    return m.attacks[magic_index(m, occupied)];
+}
+
+inline Bitboard queen_attacks(int square, Bitboard occupied) {
+    return bishop_attacks(square, occupied) | rook_attacks(square, occupied);
+}
+
+// Must run once before any move generation or Position setup
+void init_bitboards();
+
+#endif  // CHESSAI_POSITION_H
@@ -0,0 +1,1027 @@
+#include "search.h"
+
+#include <chrono>
+#include <random>
+
+using namespace std;
+
+#define SCORE_INF 1000000
+#define BEST_FIRST_NODES 20000
+#define VIRTUAL_LOSS 50
+#define MAX_TREE_DEPTH 128
+#define LIMIT_POLL_NODES 1024
+#define DELTA_MARGIN 200
+#define HISTORY_MAX 16384
+
+TranspositionTable transposition_table;
+
+// Raises a bound shared between sibling workers, never lowering it
+void raise_bound(atomic<int>& bound, int score) {
+    int current = bound.load(memory_order_relaxed);
+    while (score > current && !bound.compare_exchange_weak(current, score, memory_order_relaxed)) {
+    }
+}
+
+thread_local atomic<uint64_t> thread_nodes{0};
+
+inline void count_node() {
+    thread_nodes.store(thread_nodes.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+thread_local int ThreadPool::worker_index = -1;
+
+ThreadPool search_pool;
+
+int search_split_depth = SPLIT_DEPTH;
+
+uint64_t total_nodes() {
+    return search_pool.nodes() + thread_nodes.load(memory_order_relaxed);
+}
+
+// Young Brothers Wait Concept: split nodes only go parallel after their
+// first move has been searched serially
+bool young_brothers_wait = false;
+
+// Set to make every running search unwind; their partial results are
+// discarded. Searches clear it when they return, not when they start, so a
+// stop sent from another thread just after starting a search is not lost.
+atomic<bool> stop_search{false};
+
+// Lazy SMP threads each search the whole tree on their own and never split
+thread_local bool serial_search = false;
+
+// Armed by start_limits; every thread polls them through check_limits and
+// raises stop_search once the deadline or node budget has passed. Nodes are
+// those of the pool plus the thread that started the search.
+atomic<bool> limits_armed{false};
+SearchLimits armed_limits;
+chrono::steady_clock::time_point search_deadline;
+uint64_t search_node_limit = 0;
+const atomic<uint64_t>* limits_owner = &thread_nodes;
+thread_local uint32_t limit_poll = 0;
+
+// start_limits and ponder_hit are the only writers of the budget. Readers
+// in check_limits skip it while pondering is set, and ponder_hit clears
+// pondering only after writing the new budget.
+atomic<bool> pondering{false};
+mutex limits_lock;
+chrono::steady_clock::time_point ponder_hit_at;
+
+// Counts armed_limits from the given time and node total
+void set_budget(chrono::steady_clock::time_point start, uint64_t startNodes) {
+    search_deadline = armed_limits.seconds > 0
+        ? start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(armed_limits.seconds))
+        : chrono::steady_clock::time_point::max();
+    search_node_limit = armed_limits.nodes ? startNodes + armed_limits.nodes : UINT64_MAX;
+}
+
+// startNodes is total_nodes() on the owner thread when the search began. A
+// ponder search whose move was played before this point spends its budget
+// from the ponder hit instead.
+void start_limits(const SearchLimits& limits, const atomic<uint64_t>* owner,
+                  chrono::steady_clock::time_point start, uint64_t startNodes) {
+    lock_guard<mutex> lock(limits_lock);
+    limits_owner = owner;
+    armed_limits = limits;
+    set_budget(max(start, ponder_hit_at), startNodes);
+    limits_armed.store(true, memory_order_release);
+}
+
+void clear_limits() {
+    limits_armed.store(false, memory_order_relaxed);
+}
+
+void ponder_hit() {
+    lock_guard<mutex> lock(limits_lock);
+    if (!pondering.load(memory_order_relaxed)) return;
+    ponder_hit_at = chrono::steady_clock::now();
+    if (limits_armed.load(memory_order_acquire)) {
+        set_budget(ponder_hit_at, search_pool.nodes() + limits_owner->load(memory_order_relaxed));
+    }
+    pondering.store(false, memory_order_release);
+}
+
+inline void check_limits() {
+    if ((++limit_poll & (LIMIT_POLL_NODES - 1)) || !limits_armed.load(memory_order_acquire)) return;
+    if (pondering.load(memory_order_acquire)) return;  // no budget on the opponent's time
+    if (chrono::steady_clock::now() >= search_deadline ||
+        search_pool.nodes() + limits_owner->load(memory_order_relaxed) >= search_node_limit) {
+        stop_search.store(true, memory_order_relaxed);
+    }
+}
+
+int alpha_beta(Position& board, int depth, bool isWhiteTurn, int alpha, int beta);
+
+// Fail-soft quiescence search, run where alpha_beta reaches depth 0. The
+// side to move may stand pat on the static eval or try captures, so the
+// horizon never scores a position with a piece left hanging. Captures that
+// could not raise the score to alpha even when winning the victim plus
+// DELTA_MARGIN are skipped (delta pruning), and so are captures that lose
+// material by SEE.
+int quiescence(Position& board, bool isWhiteTurn, int alpha, int beta) {
+    count_node();
+    check_limits();
+    if (stop_search.load(memory_order_relaxed)) return 0;
+
+    // In check there is no standing pat: every evasion is searched, and
+    // having none is mate
+    const LegalityInfo info = legality_info(board, isWhiteTurn);
+    if (info.checkers) {
+        MoveList evasions;
+        generate_legal(board, isWhiteTurn, info, GEN_ALL, evasions);
+        int bestScore = -MATE_SCORE;
+        for (const auto& move : evasions) {
+            UndoInfo undo;
+            board.make_move(move, undo);
+            int score = -quiescence(board, !isWhiteTurn, -beta, -alpha);
+            board.unmake_move(move, undo);
+            if (score > bestScore) {
+                bestScore = score;
+                if (score > alpha) alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
+        return bestScore;
+    }
+
+    int bestScore = evaluate_for(board, isWhiteTurn);
+    if (bestScore >= beta) return bestScore;
+    const int standPat = bestScore;
+    if (standPat > alpha) alpha = standPat;
+
+    MoveList captures;
+    generate_captures(board, isWhiteTurn, info, captures);
+    for (const auto& move : captures) {
+        // Promotions and en passant are always tried
+        if (move.flags() == NORMAL_MOVE) {
+            const int victim = piece_values[board.squares[move.to()]];
+            if (standPat + victim + DELTA_MARGIN <= alpha) continue;
+            if (victim < piece_values[board.squares[move.from()]] && see(board, move) < 0) continue;
+        }
+
+        UndoInfo undo;
+        board.make_move(move, undo);
+        int score = -quiescence(board, !isWhiteTurn, -beta, -alpha);
+        board.unmake_move(move, undo);
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) alpha = score;
+            if (alpha >= beta) break;
+        }
+    }
+    return bestScore;
+}
+
+// Destination of the move that led to the node this thread is about to
+// search, read by alpha_beta on entry to look up the countermove
+thread_local int previous_to = -1;
+
+// Searches one child in place and restores the board before returning
+int search_child(Position& board, const Move& move, int depth, bool isWhiteTurn, int alpha, int beta) {
+    UndoInfo undo;
+    board.make_move(move, undo);
+    previous_to = move.to();
+    int score = -alpha_beta(board, depth - 1, !isWhiteTurn, -beta, -alpha);
+    board.unmake_move(move, undo);
+    return score;
+}
+
+// Moves the hash move, if present, to the front of the list
+void order_hash_move(MoveList& moves, Move hashMove) {
+    if (hashMove == MOVE_NONE) return;
+    for (auto& move : moves) {
+        if (move == hashMove) {
+            swap(move, moves.front());
+            return;
+        }
+    }
+}
+
+// Mate scores count the depth left at the mated node (see no_moves_score),
+// which only means something at the depth they were searched with. The
+// table holds them as plies to mate from the stored node instead, and a
+// probe converts them back for the depth it searches with.
+inline int score_to_tt(int score, int depth) {
+    if (score >= MATE_THRESHOLD) return score - depth;
+    if (score <= -MATE_THRESHOLD) return score + depth;
+    return score;
+}
+
+inline int score_from_tt(int score, int depth) {
+    if (score >= MATE_THRESHOLD) return score + depth;
+    if (score <= -MATE_THRESHOLD) return score - depth;
+    return score;
+}
+
+void store_result(uint64_t key, int depth, int alphaOrig, int beta, int bestScore, const Move& bestMove) {
+    Bound bound = bestScore <= alphaOrig ? BOUND_UPPER : bestScore >= beta ? BOUND_LOWER : BOUND_EXACT;
+    transposition_table.store(key, depth, bound, score_to_tt(bestScore, depth),
+                              bound == BOUND_UPPER ? MOVE_NONE : bestMove);
+}
+
+// Move ordering state, one copy per thread so workers never contend on it.
+// Killers are the last two quiet moves to cause a cutoff at each remaining
+// depth. The butterfly history, indexed [side][from][to], rewards quiet
+// cutoff moves and penalises the quiets searched before them. Countermoves
+// hold the quiet reply that refuted a move, keyed by the piece it moved
+// and its destination.
+struct MoveOrdering {
+    Move killers[MAX_ITERATIONS + 2][2] = {};
+    int history[2][64][64] = {};
+    Move countermoves[13][64] = {};
+
+    const Move* killersAt(int depth) const {
+        return depth < MAX_ITERATIONS + 2 ? killers[depth] : nullptr;
+    }
+
+    Move counterMove(const Position& board, int prevTo) const {
+        return prevTo >= 0 ? countermoves[board.squares[prevTo]][prevTo] : MOVE_NONE;
+    }
+
+    int historyOf(bool isWhiteTurn, const Move& move) const {
+        return history[isWhiteTurn ? WHITE : BLACK][move.from()][move.to()];
+    }
+
+    // Called on a beta cutoff by the quiet move best; tried lists the quiet
+    // moves searched before it at this node
+    void update(const Position& board, bool isWhiteTurn, int depth, int prevTo, const Move& best,
+                const Move* tried, int triedCount) {
+        if (depth < MAX_ITERATIONS + 2 && killers[depth][0] != best) {
+            killers[depth][1] = killers[depth][0];
+            killers[depth][0] = best;
+        }
+        if (prevTo >= 0) countermoves[board.squares[prevTo]][prevTo] = best;
+
+        int bonus = min(depth * depth, HISTORY_MAX / 64);
+        adjustHistory(isWhiteTurn, best, bonus);
+        for (int i = 0; i < triedCount; ++i) adjustHistory(isWhiteTurn, tried[i], -bonus);
+    }
+
+private:
+    // Gravity update: entries saturate towards +-HISTORY_MAX instead of
+    // overflowing, and old results fade as new ones come in
+    void adjustHistory(bool isWhiteTurn, const Move& move, int bonus) {
+        int& entry = history[isWhiteTurn ? WHITE : BLACK][move.from()][move.to()];
+        entry += bonus - entry * abs(bonus) / HISTORY_MAX;
+    }
+};
+
+thread_local MoveOrdering move_ordering;
+
+// Hands out a node's moves one stage at a time: hash move, winning
+// captures by MVV-LVA, killers and the countermove, quiet moves by history,
+// captures that lose material by SEE. Each stage is generated only once
+// the one before it runs out, so a node that cuts off early never pays for
+// the rest.
+class MovePicker {
+public:
+    MovePicker(const Position& board, bool isWhiteTurn, const LegalityInfo& info, Move hashMove,
+               const MoveOrdering& ordering, int depth, int prevTo)
+            : board(board), isWhiteTurn(isWhiteTurn), info(info), ordering(ordering), hashMove(hashMove),
+              stage(HASH_MOVE), index(0) {
+        const Move* killers = ordering.killersAt(depth);
+        refutations[0] = killers ? killers[0] : MOVE_NONE;
+        refutations[1] = killers && killers[1] != refutations[0] ? killers[1] : MOVE_NONE;
+        Move counter = ordering.counterMove(board, prevTo);
+        refutations[2] = counter != refutations[0] && counter != refutations[1] ? counter : MOVE_NONE;
+    }
+
+    // Next move to search, or false once every stage is exhausted
+    bool next(Move& move) {
+        while (true) {
+            switch (stage) {
+                case HASH_MOVE:
+                    stage = GENERATE_CAPTURES;
+                    if (hashMove != MOVE_NONE && is_legal(board, isWhiteTurn, info, hashMove)) {
+                        move = hashMove;
+                        return true;
+                    }
+                    hashMove = MOVE_NONE;
+                    break;
+
+                case GENERATE_CAPTURES:
+                    generate_captures(board, isWhiteTurn, info, captures);
+                    stage = GOOD_CAPTURES;
+                    break;
+
+                case GOOD_CAPTURES:
+                    while (index < captures.size()) {
+                        move = captures[index++];
+                        if (move == hashMove) continue;
+                        if (!isWinningCapture(move)) {
+                            badCaptures.push_back(move);
+                            continue;
+                        }
+                        return true;
+                    }
+                    stage = REFUTATIONS;
+                    index = 0;
+                    break;
+
+                case REFUTATIONS:
+                    while (index < 3) {
+                        move = refutations[index++];
+                        if (move == MOVE_NONE || move == hashMove) continue;
+                        if (is_quiet(board, move) && is_legal(board, isWhiteTurn, info, move)) {
+                            return true;
+                        }
+                    }
+                    stage = GENERATE_QUIETS;
+                    break;
+
+                case GENERATE_QUIETS:
+                    generate_legal(board, isWhiteTurn, info, GEN_QUIETS, quiets);
+                    for (int i = 0; i < quiets.size(); ++i) {
+                        quietScores[i] = ordering.historyOf(isWhiteTurn, quiets[i]);
+                    }
+                    stage = QUIETS;
+                    index = 0;
+                    break;
+
+                case QUIETS:
+                    // Selection rather than a full sort: most nodes cut off
+                    // after a few quiets, so the rest never need ordering
+                    while (index < quiets.size()) {
+                        int best = index;
+                        for (int i = index + 1; i < quiets.size(); ++i) {
+                            if (quietScores[i] > quietScores[best]) best = i;
+                        }
+                        swap(quiets[best], quiets[index]);
+                        swap(quietScores[best], quietScores[index]);
+                        move = quiets[index++];
+                        if (move == hashMove || move == refutations[0] || move == refutations[1] ||
+                            move == refutations[2]) {
+                            continue;
+                        }
+                        return true;
+                    }
+                    stage = BAD_CAPTURES;
+                    index = 0;
+                    break;
+
+                case BAD_CAPTURES:
+                    if (index < badCaptures.size()) {
+                        move = badCaptures[index++];
+                        return true;
+                    }
+                    stage = DONE;
+                    break;
+
+                case DONE:
+                    return false;
+            }
+        }
+    }
+
+private:
+    enum Stage {
+        HASH_MOVE, GENERATE_CAPTURES, GOOD_CAPTURES, REFUTATIONS, GENERATE_QUIETS, QUIETS, BAD_CAPTURES, DONE
+    };
+
+    const Position& board;
+    bool isWhiteTurn;
+    const LegalityInfo& info;
+    const MoveOrdering& ordering;
+    Move hashMove;
+    Move refutations[3];  // two killers and the countermove
+    Stage stage;
+    int index;
+    MoveList captures, quiets, badCaptures;
+    int quietScores[MAX_MOVES];  // history of quiets[i]
+
+    bool isWinningCapture(const Move& move) const {
+        // Promotions and en passant go with the winning captures. Taking
+        // something at least as valuable can't lose; skip the SEE
+        if (move.flags() != NORMAL_MOVE) return true;
+        if (piece_values[board.squares[move.to()]] >= piece_values[board.squares[move.from()]]) return true;
+        return see(board, move) >= 0;
+    }
+};
+
+// Children of a split node, searched as pool tasks. Each task copies the
+// parent board, reads the best alpha found so far by its siblings, and
+// raises it afterwards. A beta cutoff makes the tasks not yet started
+// return at once and the ones in flight abort, through search_aborted.
+struct SplitPoint {
+    atomic<int> alpha;
+    atomic<bool> cutoff{false};
+    const SplitPoint* parent = nullptr;  // split point this node was searched under
+    mutex lock;
+    int bestScore = -SCORE_INF;
+    Move bestMove;
+};
+
+// Split point of the task this thread is running, if any
+thread_local const SplitPoint* current_split = nullptr;
+
+// True once the search is stopped or a split point above this thread has
+// cut off; either way whatever it is searching will be thrown away
+inline bool search_aborted() {
+    if (stop_search.load(memory_order_relaxed)) return true;
+    for (const SplitPoint* split = current_split; split; split = split->parent) {
+        if (split->cutoff.load(memory_order_relaxed)) return true;
+    }
+    return false;
+}
+
+void search_split(Position& board, const MoveList& moves, int depth, bool isWhiteTurn,
+                  int beta, int alphaMargin, SplitPoint& split) {
+    int first = 0;
+
+    // YBWC: the eldest brother is searched here alone first. Its bound lets
+    // the younger ones prune, and if it already cuts off they never start.
+    if (young_brothers_wait) {
+        int score = search_child(board, moves[0], depth, isWhiteTurn,
+                                 split.alpha.load(memory_order_relaxed) - alphaMargin, beta);
+        split.bestScore = score;
+        split.bestMove = moves[0];
+        raise_bound(split.alpha, score);
+        if (score >= beta) return;
+        first = 1;
+    }
+
+    TaskGroup group;
+    for (int i = first; i < moves.size(); ++i) {
+        search_pool.submit(group, [&, move = moves[i]] {
+            const SplitPoint* outer = current_split;
+            current_split = &split;
+            if (!search_aborted()) {
+                Position local = board;
+                int score = search_child(local, move, depth, isWhiteTurn,
+                                         split.alpha.load(memory_order_relaxed) - alphaMargin, beta);
+                // A score cut short by an abort is not a real bound
+                if (!search_aborted()) {
+                    {
+                        lock_guard<mutex> lock(split.lock);
+                        if (score > split.bestScore) {
+                            split.bestScore = score;
+                            split.bestMove = move;
+                        }
+                    }
+                    raise_bound(split.alpha, score);
+                    if (score >= beta) split.cutoff.store(true, memory_order_relaxed);
+                }
+            }
+            current_split = outer;
+        });
+    }
+    search_pool.wait(group);
+}
+
+// Score of a node without legal moves: mate or stalemate. Mates found with
+// more depth left are closer to the root, so they score further from zero
+// and the search prefers the quickest one.
+inline int no_moves_score(const LegalityInfo& info, int depth) {
+    return info.checkers ? -MATE_SCORE - depth : 0;
+}
+
+// Fail-soft negamax alpha-beta. Scores are relative to the side to move.
+// Under YBWC, nodes with at least search_split_depth plies left split their
+// move loop across the thread pool once the eldest move is searched. Plain
+// alpha-beta only splits the root: interior nodes split before any bound is
+// known search children that a serial search would have cut off. Depth 0
+// hands over to the quiescence search.
+int alpha_beta(Position& board, int depth, bool isWhiteTurn, int alpha, int beta) {
+    if (depth <= 0) return quiescence(board, isWhiteTurn, alpha, beta);
+    count_node();
+    check_limits();
+    if (search_aborted()) return 0;
+
+    const int alphaOrig = alpha;
+    const uint64_t key = position_key(board, isWhiteTurn);
+    TTData tt{0, 0, BOUND_NONE, MOVE_NONE};
+    if (transposition_table.probe(key, tt) && tt.depth >= depth) {
+        tt.score = score_from_tt(tt.score, depth);
+        if (tt.bound == BOUND_EXACT ||
+            (tt.bound == BOUND_LOWER && tt.score >= beta) ||
+            (tt.bound == BOUND_UPPER && tt.score <= alpha)) {
+            return tt.score;
+        }
+    }
+
+    const int prevTo = previous_to;
+    const LegalityInfo info = legality_info(board, isWhiteTurn);
+    MovePicker picker(board, isWhiteTurn, info, tt.move, move_ordering, depth, prevTo);
+    Move move;
+
+    if (young_brothers_wait && depth >= search_split_depth && search_pool.size() > 1 && !serial_search) {
+        // Split nodes hand whole move lists to the pool, in picker order
+        MoveList moves;
+        while (picker.next(move)) moves.push_back(move);
+        if (moves.empty()) return no_moves_score(info, depth);
+
+        SplitPoint split;
+        split.alpha = alpha;
+        split.parent = current_split;
+        split.bestMove = moves.front();
+        search_split(board, moves, depth, isWhiteTurn, beta, 0, split);
+        if (search_aborted()) return split.bestScore;
+        if (split.bestScore >= beta && is_quiet(board, split.bestMove)) {
+            move_ordering.update(board, isWhiteTurn, depth, prevTo, split.bestMove, nullptr, 0);
+        }
+        store_result(key, depth, alphaOrig, beta, split.bestScore, split.bestMove);
+        return split.bestScore;
+    }
+
+    int bestScore = -SCORE_INF;
+    Move bestMove = MOVE_NONE;
+    Move quietsTried[64];
+    int quietCount = 0;
+    while (picker.next(move)) {
+        bool quiet = is_quiet(board, move);
+        int score = search_child(board, move, depth, isWhiteTurn, alpha, beta);
+        if (search_aborted()) return bestScore;  // discarded by the caller
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+            if (score > alpha) alpha = score;
+            if (alpha >= beta) {  // beta cutoff
+                if (quiet) move_ordering.update(board, isWhiteTurn, depth, prevTo, move, quietsTried, quietCount);
+                break;
+            }
+        }
+        if (quiet && quietCount < 64) quietsTried[quietCount++] = move;
+    }
+    if (bestMove == MOVE_NONE) return no_moves_score(info, depth);
+    store_result(key, depth, alphaOrig, beta, bestScore, bestMove);
+    return bestScore;
+}
+
+// Root moves always go to the pool. Each is searched one below the best
+// score so far, so a fail-low can never tie the real best move.
+Move split_root(Position& board, const MoveList& moves, int depth, bool isWhiteTurn, int& bestScore) {
+    SplitPoint split;
+    split.alpha = -SCORE_INF;
+    split.bestMove = MOVE_NONE;
+    search_split(board, moves, depth, isWhiteTurn, SCORE_INF, 1, split);
+
+    bestScore = split.bestScore;
+    if (split.bestMove != MOVE_NONE && !stop_search.load(memory_order_relaxed)) {
+        transposition_table.store(position_key(board, isWhiteTurn), depth, BOUND_EXACT,
+                                  score_to_tt(split.bestScore, depth), split.bestMove);
+    }
+    return split.bestMove;
+}
+
+// Searches depth 1, 2, ... until limits.maxDepth or until the time or node
+// budget runs out, and returns the result of the last iteration that
+// finished. Each iteration searches the previous best move first. Depth 1
+// always completes so there is a move to play even on a tiny budget.
+Move iterative_deepening(Position& board, bool isWhiteTurn, const SearchLimits& limits,
+                         SearchStats* stats = nullptr) {
+    auto start = chrono::steady_clock::now();
+    uint64_t startNodes = total_nodes();
+    MoveList moves = generate_moves(board, isWhiteTurn);
+    if (moves.empty()) return MOVE_NONE;
+    TTData tt{0, 0, BOUND_NONE, MOVE_NONE};
+    if (transposition_table.probe(position_key(board, isWhiteTurn), tt)) {
+        order_hash_move(moves, tt.move);
+    }
+    transposition_table.new_search();
+
+    Move bestMove = moves.front();
+    int bestScore = -SCORE_INF, completed = 0;
+    for (int depth = 1; depth <= max(limits.maxDepth, 1); ++depth) {
+        int score;
+        Move move = split_root(board, moves, depth, isWhiteTurn, score);
+        if (stop_search.load(memory_order_relaxed)) break;
+
+        bestMove = move;
+        bestScore = score;
+        completed = depth;
+        order_hash_move(moves, move);
+        if (depth == 1) start_limits(limits, &thread_nodes, start, startNodes);
+    }
+    clear_limits();
+    stop_search = false;
+
+    if (stats) {
+        stats->nodes += total_nodes() - startNodes;
+        stats->depth = completed;
+        stats->score = bestScore;
+    }
+    return bestMove;
+}
+
+// Serial root search for the iterative-deepening threads. Returns the best
+// score and moves the best move to the front, keeping the rest in order.
+int search_root(Position& board, MoveList& moves, int depth, bool isWhiteTurn) {
+    int alpha = -SCORE_INF, bestScore = -SCORE_INF;
+    int bestIndex = 0;
+    for (int i = 0; i < moves.size(); ++i) {
+        int score = search_child(board, moves[i], depth, isWhiteTurn, alpha, SCORE_INF);
+        if (stop_search.load(memory_order_relaxed)) break;
+        if (score > bestScore) {
+            bestScore = score;
+            bestIndex = i;
+            alpha = max(alpha, score);
+        }
+    }
+    rotate(moves.begin(), moves.begin() + bestIndex, moves.begin() + bestIndex + 1);
+    return bestScore;
+}
+
+// Lazy SMP: every pool thread runs its own iterative-deepening search of the
+// whole root, and they cooperate only through the shared transposition
+// table. Helpers start from a shuffled root order and odd ones search one
+// ply deeper, so they fill the table with different parts of the tree. The
+// deepest completed iteration wins; the main thread's wins ties and stops
+// the helpers when it finishes limits.maxDepth or the budget runs out.
+Move lazy_smp_move(Position& board, bool isWhiteTurn, const SearchLimits& limits, SearchStats* stats = nullptr) {
+    auto start = chrono::steady_clock::now();
+    uint64_t startNodes = total_nodes();
+    const atomic<uint64_t>* owner = &thread_nodes;
+    MoveList rootMoves = generate_moves(board, isWhiteTurn);
+    if (rootMoves.empty()) return MOVE_NONE;
+    transposition_table.new_search();
+
+    mutex resultLock;
+    Move bestMove = rootMoves.front();
+    int bestScore = -SCORE_INF, bestDepth = 0;
+
+    TaskGroup group;
+    int threads = max(search_pool.size(), 1);
+    for (int t = 0; t < threads; ++t) {
+        search_pool.submit(group, [&, t] {
+            serial_search = true;
+            Position local = board;
+            MoveList moves = rootMoves;
+            if (t > 0) {
+                mt19937 rng(t);
+                shuffle(moves.begin(), moves.end(), rng);
+            }
+
+            for (int depth = 1; depth <= max(limits.maxDepth, 1); ++depth) {
+                int searchDepth = depth + (t & 1);
+                int score = search_root(local, moves, searchDepth, isWhiteTurn);
+                if (stop_search.load(memory_order_relaxed)) break;
+
+                {
+                    lock_guard<mutex> lock(resultLock);
+                    if (searchDepth > bestDepth || (searchDepth == bestDepth && t == 0)) {
+                        bestDepth = searchDepth;
+                        bestScore = score;
+                        bestMove = moves.front();
+                    }
+                }
+                if (t == 0 && depth == 1) start_limits(limits, owner, start, startNodes);
+            }
+            if (t == 0) stop_search = true;
+            serial_search = false;
+        });
+    }
+    search_pool.wait(group);
+    clear_limits();
+    stop_search = false;
+
+    if (stats) {
+        stats->nodes += total_nodes() - startNodes;
+        stats->depth = bestDepth;
+        stats->score = bestScore;
+    }
+    return bestMove;
+}
+
+struct BestFirstOptions {
+    int maxNodes = BEST_FIRST_NODES;  // size of the in-memory tree
+    int leafDepth = 2;                // alpha-beta depth used to score new leaves
+    int threads = 0;                  // 0 = one worker per pool thread
+};
+
+// Parallel best-first minimax (Korf & Chickering). The game tree is kept in
+// memory and grown by repeatedly expanding the leaf at the end of the
+// principal variation, then backing the new values up to the root.
+// Each worker descends from the root on its own board; a virtual loss on
+// every node it passes through steers the other workers onto different
+// frontier leaves while its expansion is in flight.
+class BestFirstSearch {
+public:
+    // The tree always has room for the root and all of its children
+    BestFirstSearch(const Position& board, bool isWhiteTurn, const BestFirstOptions& opts)
+            : rootBoard(board), rootWhite(isWhiteTurn), options(opts), nodeCount(1), iterations(0), done(false) {
+        options.maxNodes = max(options.maxNodes, MAX_MOVES + 1);
+        nodes.reset(new Node[options.maxNodes]);
+    }
+
+    // Searches within the time and node budget of limits; maxDepth does not
+    // apply. The root is expanded before the budget is armed, so every legal
+    // move has a score and one is returned however small the budget.
+    Move run(const SearchLimits& limits, SearchStats* stats) {
+        auto start = chrono::steady_clock::now();
+        uint64_t startNodes = total_nodes();
+        int threads = options.threads > 0 ? options.threads : max(search_pool.size(), 1);
+
+        Position board = rootBoard;
+        nodes[0].state.store(EXPANDING);
+        expand(0, board, rootWhite, 0);
+        backup(0);
+        start_limits(limits, &thread_nodes, start, startNodes);
+
+        TaskGroup group;
+        for (int i = 0; i < threads; ++i) {
+            search_pool.submit(group, [this] { worker(); });
+        }
+        search_pool.wait(group);
+        clear_limits();
+        if (stats) stats->nodes += total_nodes() - startNodes;
+
+        const Node& root = nodes[0];
+        if (root.state.load() == TERMINAL) return MOVE_NONE;  // mate or stalemate
+        if (root.state.load() != EXPANDED) return generate_moves(rootBoard, rootWhite).front();  // stopped at once
+        if (stats) {
+            stats->score = root.value.load();
+            stats->depth = principalDepth();
+        }
+        return nodes[bestChild(0, false)].move;
+    }
+
+private:
+    enum NodeState { UNEXPANDED, EXPANDING, EXPANDED, TERMINAL };
+
+    struct Node {
+        Move move = MOVE_NONE;         // move that leads here from the parent
+        int parent = -1;
+        int firstChild = -1;           // published by the EXPANDED state
+        int childCount = 0;
+        atomic<int> value{0};          // negamax value for the side to move here
+        atomic<int> virtualLoss{0};    // workers currently below this node
+        atomic<int> state{UNEXPANDED};
+        atomic<bool> locked{false};
+    };
+
+    Position rootBoard;
+    bool rootWhite;
+    BestFirstOptions options;
+    unique_ptr<Node[]> nodes;
+    atomic<int> nodeCount;
+    atomic<int> iterations;
+    atomic<bool> done;
+
+    // Child the parent's side to move prefers; virtual loss makes children
+    // that other workers are busy under look worse
+    int bestChild(int index, bool withVirtualLoss) const {
+        const Node& node = nodes[index];
+        int best = -1, bestScore = INT_MIN;
+        for (int i = node.firstChild; i < node.firstChild + node.childCount; ++i) {
+            int score = -nodes[i].value.load(memory_order_relaxed);
+            if (withVirtualLoss) score -= VIRTUAL_LOSS * nodes[i].virtualLoss.load(memory_order_relaxed);
+            if (score > bestScore) {
+                bestScore = score;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    // Creates and scores the children of a leaf ply moves below the root;
+    // false once the tree is full. Mates nearer the root score further from
+    // zero, so the shortest one is preferred.
+    bool expand(int index, Position& board, bool isWhiteTurn, int ply) {
+        Node& node = nodes[index];
+        MoveList moves = generate_moves(board, isWhiteTurn);
+        if (moves.empty()) {
+            node.value.store(is_king_in_check(board, isWhiteTurn) ? -(MATE_SCORE - ply) : 0);  // mate or stalemate
+            node.state.store(TERMINAL, memory_order_release);
+            return true;
+        }
+
+        int first = nodeCount.fetch_add(moves.size());
+        if (first + moves.size() > options.maxNodes) {
+            node.state.store(UNEXPANDED, memory_order_release);
+            return false;
+        }
+
+        for (int i = 0; i < moves.size(); ++i) {
+            Node& child = nodes[first + i];
+            child.move = moves[i];
+            child.parent = index;
+
+            UndoInfo undo;
+            board.make_move(moves[i], undo);
+            child.value.store(alpha_beta(board, options.leafDepth, !isWhiteTurn, -SCORE_INF, SCORE_INF));
+            board.unmake_move(moves[i], undo);
+        }
+        // Scores cut short by a stop are not published; the leaf stays open
+        if (stop_search.load(memory_order_relaxed)) {
+            node.state.store(UNEXPANDED, memory_order_release);
+            return true;
+        }
+
+        node.firstChild = first;
+        node.childCount = moves.size();
+        node.state.store(EXPANDED, memory_order_release);
+        return true;
+    }
+
+    // Recomputes values from the expanded node up to the root. Each node is
+    // locked while it reads its children, so a concurrent backup through the
+    // same node can never leave an older value behind.
+    void backup(int index) {
+        while (index >= 0) {
+            Node& node = nodes[index];
+            if (node.state.load(memory_order_acquire) == EXPANDED) {
+                while (node.locked.exchange(true, memory_order_acquire)) {
+                    this_thread::yield();
+                }
+                node.value.store(-nodes[bestChild(index, false)].value.load());
+                node.locked.store(false, memory_order_release);
+            }
+            index = node.parent;
+        }
+    }
+
+    // Length of the principal variation in the tree
+    int principalDepth() const {
+        int index = 0, depth = 0;
+        for (; nodes[index].state.load(memory_order_acquire) == EXPANDED; ++depth) index = bestChild(index, false);
+        return depth;
+    }
+
+    // True when the principal variation, without virtual loss, ends in a
+    // terminal leaf: no expansion can change the root's value any more
+    bool settled() const {
+        int index = 0;
+        while (nodes[index].state.load(memory_order_acquire) == EXPANDED) index = bestChild(index, false);
+        return nodes[index].state.load(memory_order_acquire) == TERMINAL;
+    }
+
+    // Whether the position at the end of the path already occurred on it,
+    // with the same side to move and no irreversible move in between
+    static bool repeats(const uint64_t* keys, int depth, int halfmoveClock) {
+        for (int back = 4; back <= min(depth, halfmoveClock); back += 2) {
+            if (keys[depth - back] == keys[depth]) return true;
+        }
+        return false;
+    }
+
+    void worker() {
+        Position board = rootBoard;
+        int path[MAX_TREE_DEPTH];
+        UndoInfo undo[MAX_TREE_DEPTH];
+        uint64_t keys[MAX_TREE_DEPTH + 1];  // position keys along the path
+        keys[0] = board.key;
+
+        while (!done.load(memory_order_relaxed) && !stop_search.load(memory_order_relaxed)) {
+            // Follow the principal variation (as seen through virtual loss) to a leaf
+            int index = 0, depth = 0;
+            bool isWhiteTurn = rootWhite;
+            while (nodes[index].state.load(memory_order_acquire) == EXPANDED && depth < MAX_TREE_DEPTH) {
+                int child = bestChild(index, true);
+                nodes[child].virtualLoss.fetch_add(1, memory_order_relaxed);
+                board.make_move(nodes[child].move, undo[depth]);
+                path[depth++] = child;
+                keys[depth] = board.key;
+                index = child;
+                isWhiteTurn = !isWhiteTurn;
+            }
+
+            int expected = UNEXPANDED;
+            bool progressed = true;
+            if (depth == MAX_TREE_DEPTH || repeats(keys, depth, board.halfmoveClock)) {
+                // A repetition is a draw, and so, settled rather than left
+                // open forever, is a line too deep to expand
+                if (nodes[index].state.compare_exchange_strong(expected, TERMINAL)) {
+                    nodes[index].value.store(0);
+                    backup(nodes[index].parent);
+                }
+                expected = TERMINAL;
+            } else if (nodes[index].state.compare_exchange_strong(expected, EXPANDING)) {
+                if (!expand(index, board, isWhiteTurn, depth)) done.store(true);
+                backup(index);
+            }
+            if (expected == EXPANDING) {
+                // Another worker owns this leaf; try again
+                progressed = false;
+                this_thread::yield();
+            } else if (expected == TERMINAL) {
+                // Virtual loss may have led here while other leaves are open
+                if (settled()) done.store(true);
+                progressed = false;
+                this_thread::yield();
+            }
+
+            while (depth > 0) {
+                --depth;
+                board.unmake_move(nodes[path[depth]].move, undo[depth]);
+                nodes[path[depth]].virtualLoss.fetch_sub(1, memory_order_relaxed);
+            }
+
+            // Caps the loop when the principal variation ends in terminal leaves
+            if (progressed && iterations.fetch_add(1, memory_order_relaxed) >= options.maxNodes) {
+                done.store(true);
+            }
+        }
+    }
+};
+
+Move best_first_move(Position& board, bool isWhiteTurn, const SearchLimits& limits,
+                     const BestFirstOptions& options = BestFirstOptions(), SearchStats* stats = nullptr) {
+    BestFirstSearch search(board, isWhiteTurn, options);
+    Move move = search.run(limits, stats);
+    stop_search = false;
+    return move;
+}
+
+Move ponder_move(const Position& board, bool isWhiteTurn, const Move& move) {
+    Position child = board;
+    UndoInfo undo;
+    child.make_move(move, undo);
+    TTData tt;
+    if (!transposition_table.probe(position_key(child, !isWhiteTurn), tt) || tt.move == MOVE_NONE) return MOVE_NONE;
+    return is_legal(child, !isWhiteTurn, legality_info(child, !isWhiteTurn), tt.move) ? tt.move : MOVE_NONE;
+}
+
+const char* search_mode_name(SearchMode mode) {
+    switch (mode) {
+        case BEST_FIRST_SEARCH: return "best-first";
+        case LAZY_SMP_SEARCH: return "lazy-smp";
+        case YBWC_SEARCH: return "ybwc";
+        default: return "alpha-beta";
+    }
+}
+
+// Runs the selected engine within limits and reports nodes, depth and wall
+// time in stats. Best-first honours the time and node budget and
+// stop_search, but grows its tree without a depth limit.
+Move find_best_move(Position& board, bool isWhiteTurn, SearchMode mode, const SearchLimits& limits,
+                    SearchStats& stats) {
+    auto start = chrono::steady_clock::now();
+    Move move;
+    switch (mode) {
+        case BEST_FIRST_SEARCH: {
+            move = best_first_move(board, isWhiteTurn, limits, BestFirstOptions(), &stats);
+            break;
+        }
+        case LAZY_SMP_SEARCH: move = lazy_smp_move(board, isWhiteTurn, limits, &stats); break;
+        case YBWC_SEARCH:
+            young_brothers_wait = true;
+            move = iterative_deepening(board, isWhiteTurn, limits, &stats);
+            young_brothers_wait = false;
+            break;
+        default: move = iterative_deepening(board, isWhiteTurn, limits, &stats); break;
+    }
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return move;
+}
+
+// Search overhead of a parallel mode: nodes it visits divided by the nodes
+// one thread visits when deepening to the same depth. Both runs start from
+// an empty transposition table and ignore time and node budgets. 1.0 means
+// no wasted work; best-first returns 0.
+double measure_search_overhead(Position& board, bool isWhiteTurn, SearchMode mode, int maxDepth) {
+    if (mode == BEST_FIRST_SEARCH) return 0;
+
+    // Both runs use an empty table of the same size; the shared one is put
+    // back afterwards, since pondering and the next search build on it
+    TranspositionTable scratch(transposition_table.megabytes());
+    transposition_table.swap(scratch);
+
+    SearchStats parallel;
+    SearchLimits limits;
+    limits.maxDepth = maxDepth;
+    find_best_move(board, isWhiteTurn, mode, limits, parallel);
+
+    transposition_table.clear();
+    serial_search = true;
+    uint64_t startNodes = thread_nodes.load(memory_order_relaxed);
+    MoveList moves = generate_moves(board, isWhiteTurn);
+    if (!moves.empty()) {
+        for (int depth = 1; depth <= maxDepth; ++depth) {
+            search_root(board, moves, depth, isWhiteTurn);
+        }
+    }
+    uint64_t serialNodes = thread_nodes.load(memory_order_relaxed) - startNodes;
+    serial_search = false;
+    transposition_table.swap(scratch);
+
+    return double(parallel.nodes) / max<uint64_t>(serialNodes, 1);
+}
+
+void BackgroundSearch::start(const Position& board, bool isWhiteTurn, SearchMode mode, const SearchLimits& limits,
+                             bool measureOverhead) {
+    cancel();
+    stopping = false;
+    stop_search = false;
+    pondering = limits.ponder;
+    result = async(launch::async, [this, board, isWhiteTurn, mode, limits, measureOverhead] {
+        Position root = board;
+        SearchResult out;
+        out.move = find_best_move(root, isWhiteTurn, mode, limits, out.stats);
+        // The overhead run is a second full search; skip it once stopped
+        if (measureOverhead && !stopping) out.overhead = measure_search_overhead(root, isWhiteTurn, mode, out.stats.depth);
+        return out;
+    });
+}
+
+void BackgroundSearch::stop() {
+    if (!result.valid()) return;
+    stopping = true;
+    stop_search = true;
+}
+
+void BackgroundSearch::cancel() {
+    if (!result.valid()) return;
+    stop();
+    result.wait();
+    result = future<SearchResult>();
+}
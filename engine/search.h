@@ -0,0 +1,403 @@
+// Search front door: the parallel engines behind find_best_move, plus the
+// thread pool and transposition table they share, which front ends size
+// and clear.
+#ifndef CHESSAI_SEARCH_H
+#define CHESSAI_SEARCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "eval.h"
+#include "movegen.h"
+
+#define MAX_DEPTH 3
+#define TT_DEFAULT_MB 64
+#define SPLIT_DEPTH 2
+#define MAX_ITERATIONS 64
+#define MATE_SCORE 100000
+// Mate scores read back from the transposition table can reach past the
+// depth of the search that reads them, landing just below MATE_SCORE; any
+// score this far from zero is still a mate
+#define MATE_THRESHOLD (MATE_SCORE - 1000)
+
+enum Bound : uint8_t { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+struct TTData {
+    int score;
+    int depth;
+    Bound bound;
+    Move move;  // MOVE_NONE when no best move is known
+};
+
+// Shared transposition table. Entries are two 64-bit words, the key being
+// stored XORed with the data word, so a probe that races a store sees a
+// key mismatch instead of a torn entry and no locks are needed. Four
+// entries fill one 64-byte bucket, so a probe touches one cache line.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t megabytes = TT_DEFAULT_MB) : generation(0) {
+        resize(megabytes);
+    }
+
+    // Rounds down to a power-of-two number of buckets and clears the table
+    void resize(size_t megabytes) {
+        size_t count = 1;
+        while (count * 2 * sizeof(Bucket) <= std::max<size_t>(megabytes, 1) << 20) count *= 2;
+        buckets.reset(new Bucket[count]);
+        bucketMask = count - 1;
+        clear();
+    }
+
+    void clear() {
+        for (size_t i = 0; i <= bucketMask; ++i) {
+            for (auto& entry : buckets[i].entries) {
+                entry.keyXorData.store(0, std::memory_order_relaxed);
+                entry.data.store(0, std::memory_order_relaxed);
+            }
+        }
+        generation = 0;
+    }
+
+    size_t megabytes() const { return ((bucketMask + 1) * sizeof(Bucket)) >> 20; }
+
+    // Exchanges contents with another table; call only while no search runs
+    void swap(TranspositionTable& other) {
+        std::swap(buckets, other.buckets);
+        std::swap(bucketMask, other.bucketMask);
+        std::swap(generation, other.generation);
+    }
+
+    // Ages out entries from earlier searches when slots are contended
+    void new_search() { generation = (generation + 1) & 63; }
+
+    bool probe(uint64_t key, TTData& out) const {
+        const Bucket& bucket = buckets[key & bucketMask];
+        for (const auto& entry : bucket.entries) {
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            if ((entry.keyXorData.load(std::memory_order_relaxed) ^ data) == key && data) {
+                out = unpack(data);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store(uint64_t key, int depth, Bound bound, int score, Move move) {
+        Bucket& bucket = buckets[key & bucketMask];
+
+        // Same position first; otherwise evict the shallowest, oldest entry
+        Entry* victim = &bucket.entries[0];
+        int victimWorth = INT_MAX;
+        for (auto& entry : bucket.entries) {
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            if ((entry.keyXorData.load(std::memory_order_relaxed) ^ data) == key) {
+                TTData old = unpack(data);
+                if (move == MOVE_NONE) move = old.move;  // keep the old best move
+                if (bound != BOUND_EXACT && depth < old.depth) return;
+                victim = &entry;
+                break;
+            }
+            int age = (generation - int((data >> 58) & 63)) & 63;
+            int worth = int((data >> 48) & 0xFF) - 8 * age;
+            if (worth < victimWorth) {
+                victimWorth = worth;
+                victim = &entry;
+            }
+        }
+
+        uint64_t data = uint64_t(uint32_t(score)) |
+                        uint64_t(move.data) << 32 |
+                        uint64_t(std::min(depth, 255)) << 48 |
+                        uint64_t(bound) << 56 |
+                        uint64_t(generation) << 58;
+        victim->keyXorData.store(key ^ data, std::memory_order_relaxed);
+        victim->data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;  // score:32 | move:16 | depth:8 | bound:2 | generation:6
+    };
+
+    struct alignas(64) Bucket {
+        Entry entries[4];
+    };
+
+    static TTData unpack(uint64_t data) {
+        return {int32_t(uint32_t(data)), int((data >> 48) & 0xFF), Bound((data >> 56) & 3), Move(uint16_t(data >> 32))};
+    }
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucketMask;
+    int generation;
+};
+
+
+extern TranspositionTable transposition_table;
+
+// Positions visited by this thread. Pool workers register theirs with the
+// pool, so a search can total them without any shared counter.
+extern thread_local std::atomic<uint64_t> thread_nodes;
+
+struct SearchStats {
+    uint64_t nodes = 0;
+    double seconds = 0;
+    int depth = 0;  // deepest completed iteration
+    int score = 0;  // of the chosen move, for the side to move
+};
+
+// Tasks submitted together; wait() returns once all of them have run
+struct TaskGroup {
+    std::atomic<int> pending{0};
+};
+
+// Work-stealing thread pool for search tasks. Every worker owns a deque:
+// it pushes and pops its own tasks at the back (depth-first), while idle
+// workers steal from the front of other deques, where the largest subtrees
+// sit. A worker that waits on a group keeps running tasks instead of
+// blocking, so nested splits never deadlock; threads outside the pool
+// submit through a shared queue and sleep until their group is done.
+class ThreadPool {
+public:
+    ThreadPool() : stopping(false), queuedTasks(0) {}
+
+    ~ThreadPool() { resize(0); }
+
+    int size() const { return int(workers.size()); }
+
+    // Restarts the pool with the given number of workers; call only while idle
+    void resize(int threads) {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCv.notify_all();
+        for (auto& worker : workers) worker.join();
+        workers.clear();
+
+        stopping = false;
+        queues.clear();
+        counters.assign(threads, nullptr);
+        for (int i = 0; i <= threads; ++i) queues.emplace_back(new TaskQueue);
+        for (int i = 0; i < threads; ++i) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+
+        // Wait until every worker has published its node counter
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCv.wait(lock, [&] { return std::count(counters.begin(), counters.end(), nullptr) == 0; });
+    }
+
+    // Without workers the task simply runs on the caller
+    void submit(TaskGroup& group, std::function<void()> fn) {
+        if (workers.empty()) {
+            fn();
+            return;
+        }
+        group.pending.fetch_add(1, std::memory_order_relaxed);
+        TaskQueue& queue = *queues[worker_index >= 0 ? worker_index : size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.lock);
+            queue.tasks.push_back({std::move(fn), &group});
+        }
+        queuedTasks.fetch_add(1, std::memory_order_release);
+        {
+            // Pairs with the predicate check in workerLoop so a worker that
+            // is about to sleep cannot miss this task
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        sleepCv.notify_one();
+    }
+
+    void wait(TaskGroup& group) {
+        if (worker_index < 0) {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCv.wait(lock, [&] { return group.pending.load(std::memory_order_acquire) == 0; });
+            return;
+        }
+        while (group.pending.load(std::memory_order_acquire) > 0) {
+            Task task;
+            if (takeTask(worker_index, task)) runTask(task);
+            else std::this_thread::yield();
+        }
+    }
+
+    // Nodes counted so far by all workers
+    uint64_t nodes() const {
+        uint64_t total = 0;
+        for (auto counter : counters) total += counter->load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        TaskGroup* group;
+    };
+
+    struct TaskQueue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    static thread_local int worker_index;  // -1 outside the pool
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<TaskQueue>> queues;  // one per worker, plus one for outside submitters
+    std::vector<std::atomic<uint64_t>*> counters;
+    bool stopping;
+    std::atomic<int> queuedTasks;
+    std::mutex sleepMutex, doneMutex;
+    std::condition_variable sleepCv, doneCv;
+
+    bool takeTask(int self, Task& task) {
+        if (queuedTasks.load(std::memory_order_acquire) == 0) return false;
+
+        // Own deque from the back, then everyone else's from the front
+        for (int i = 0; i <= size(); ++i) {
+            int victim = (self + i) % (size() + 1);
+            TaskQueue& queue = *queues[victim];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            if (queue.tasks.empty()) continue;
+            if (victim == self) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void runTask(Task& task) {
+        task.fn();
+        if (task.group->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            doneCv.notify_all();
+        }
+    }
+
+    void workerLoop(int index) {
+        worker_index = index;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            counters[index] = &thread_nodes;
+        }
+        sleepCv.notify_all();
+
+        while (true) {
+            Task task;
+            if (takeTask(index, task)) {
+                runTask(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCv.wait(lock, [&] { return stopping || queuedTasks.load(std::memory_order_acquire) > 0; });
+            if (stopping) return;
+        }
+    }
+};
+
+extern ThreadPool search_pool;
+
+// Under YBWC, nodes below this remaining depth are searched serially by one
+// worker; nodes at or above it hand each younger child to the pool as a
+// separate task. Plain alpha-beta splits only the root.
+extern int search_split_depth;
+
+// Set to make every running search unwind; their partial results are
+// discarded. Searches clear it when they return, not when they start, so
+// callers clear it before starting one.
+extern std::atomic<bool> stop_search;
+
+// Budget of the running search. Zero means unlimited; maxDepth bounds the
+// iterative deepening loops. A ponder search runs on the opponent's time:
+// its time and node budget only start counting at ponder_hit().
+struct SearchLimits {
+    int maxDepth = MAX_DEPTH;
+    double seconds = 0;
+    uint64_t nodes = 0;
+    bool ponder = false;
+};
+
+// Set while the running search is a ponder search. Like stop_search,
+// callers set it before starting the search, from limits.ponder.
+extern std::atomic<bool> pondering;
+
+// The move a ponder search expected was played: the search goes on, and
+// its budget counts from now
+void ponder_hit();
+
+enum SearchMode { ALPHA_BETA_SEARCH, BEST_FIRST_SEARCH, LAZY_SMP_SEARCH, YBWC_SEARCH };
+
+// Reply the search expects after move, read from the transposition table
+// as the second move of the principal variation; MOVE_NONE when unknown
+Move ponder_move(const Position& board, bool isWhiteTurn, const Move& move);
+
+const char* search_mode_name(SearchMode mode);
+
+// Runs the selected engine within limits and reports nodes, depth, score
+// and wall time in stats. Best-first honours the time and node budget and
+// stop_search, but not maxDepth; its depth is that of its principal
+// variation.
+Move find_best_move(Position& board, bool isWhiteTurn, SearchMode mode, const SearchLimits& limits,
+                    SearchStats& stats);
+
+// Nodes a parallel mode visits divided by the nodes one thread visits when
+// deepening to the same depth; 1.0 means no wasted work. Runs on a scratch
+// table, leaving transposition_table as it was.
+double measure_search_overhead(Position& board, bool isWhiteTurn, SearchMode mode, int maxDepth);
+
+struct SearchResult {
+    Move move;
+    SearchStats stats;
+    double overhead = 0;  // measure_search_overhead, when requested
+};
+
+// Runs find_best_move on a thread of its own so a front end stays
+// responsive: poll ready() and collect the result with get(). Searches
+// share stop_search and the pool, so only one may run at a time.
+class BackgroundSearch {
+public:
+    ~BackgroundSearch() { cancel(); }
+
+    // Searches a copy of board, cancelling any search still running. Sets
+    // pondering from limits.ponder.
+    void start(const Position& board, bool isWhiteTurn, SearchMode mode, const SearchLimits& limits,
+               bool measureOverhead = false);
+
+    // Started and not yet collected
+    bool running() const { return result.valid(); }
+
+    bool ready() const {
+        return result.valid() && result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // Waits for the search if it is still going
+    SearchResult get() { return result.get(); }
+
+    // Ends the search early; get() then returns the last finished iteration
+    void stop();
+
+    // Stops the search, waits for it and discards the result
+    void cancel();
+
+private:
+    std::future<SearchResult> result;
+    std::atomic<bool> stopping{false};
+};
+
+#endif  // CHESSAI_SEARCH_H
@@ -1,418 +1,14 @@
-#include <iostream>
-#include <vector>
-#include <climits>
-#include <omp.h>
 #include <SFML/Graphics.hpp>
-#include <algorithm>
-#include <atomic>
+#include <iostream>
+#include <string>
+
+#include "search.h"
 
 using namespace std;
 
-#define BOARD_SIZE 8
 #define TILE_SIZE 80
-#define MAX_DEPTH 3
-
-// Chess pieces enum
-enum Piece {
-    EMPTY,
-    WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING,
-    BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING
-};
-
-struct Move {
-    int fromRow, fromCol;
-    int toRow, toCol;
-    int score;  // Added score field for parallel sorting
-};
-
-bool is_white(Piece p) {
-    return p >= WHITE_PAWN && p <= WHITE_KING;
-}
-
-bool is_black(Piece p) {
-    return p >= BLACK_PAWN && p <= BLACK_KING;
-}
-
-// Piece-square tables for improved evaluation
-const int pawn_table[64] = {
-        0,  0,  0,  0,  0,  0,  0,  0,
-        50, 50, 50, 50, 50, 50, 50, 50,
-        10, 10, 20, 30, 30, 20, 10, 10,
-        5,  5, 10, 25, 25, 10,  5,  5,
-        0,  0,  0, 20, 20,  0,  0,  0,
-        5, -5,-10,  0,  0,-10, -5,  5,
-        5, 10, 10,-20,-20, 10, 10,  5,
-        0,  0,  0,  0,  0,  0,  0,  0
-};
-
-const int knight_table[64] = {
-        -50,-40,-30,-30,-30,-30,-40,-50,
-        -40,-20,  0,  0,  0,  0,-20,-40,
-        -30,  0, 10, 15, 15, 10,  0,-30,
-        -30,  5, 15, 20, 20, 15,  5,-30,
-        -30,  0, 15, 20, 20, 15,  0,-30,
-        -30,  5, 10, 15, 15, 10,  5,-30,
-        -40,-20,  0,  5,  5,  0,-20,-40,
-        -50,-40,-30,-30,-30,-30,-40,-50
-};
-
-const int bishop_table[64] = {
-        -20,-10,-10,-10,-10,-10,-10,-20,
-        -10,  0,  0,  0,  0,  0,  0,-10,
-        -10,  0,  5, 10, 10,  5,  0,-10,
-        -10,  5,  5, 10, 10,  5,  5,-10,
-        -10,  0, 10, 10, 10, 10,  0,-10,
-        -10, 10, 10, 10, 10, 10, 10,-10,
-        -10,  5,  0,  0,  0,  0,  5,-10,
-        -20,-10,-10,-10,-10,-10,-10,-20
-};
-
-const int rook_table[64] = {
-        0,  0,  0,  0,  0,  0,  0,  0,
-        5, 10, 10, 10, 10, 10, 10,  5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        0,  0,  0,  5,  5,  0,  0,  0
-};
-
-const int queen_table[64] = {
-        -20,-10,-10, -5, -5,-10,-10,-20,
-        -10,  0,  0,  0,  0,  0,  0,-10,
-        -10,  0,  5,  5,  5,  5,  0,-10,
-        -5,  0,  5,  5,  5,  5,  0, -5,
-        0,  0,  5,  5,  5,  5,  0, -5,
-        -10,  5,  5,  5,  5,  5,  0,-10,
-        -10,  0,  5,  0,  0,  0,  0,-10,
-        -20,-10,-10, -5, -5,-10,-10,-20
-};
-
-const int king_table[64] = {
-        -30,-40,-40,-50,-50,-40,-40,-30,
-        -30,-40,-40,-50,-50,-40,-40,-30,
-        -30,-40,-40,-50,-50,-40,-40,-30,
-        -30,-40,-40,-50,-50,-40,-40,-30,
-        -20,-30,-30,-40,-40,-30,-30,-20,
-        -10,-20,-20,-20,-20,-20,-20,-10,
-        20, 20,  0,  0,  0,  0, 20, 20,
-        20, 30, 10,  0,  0, 10, 30, 20
-};
-
-const int king_endgame_table[64] = {
-        -50,-40,-30,-20,-20,-30,-40,-50,
-        -30,-20,-10,  0,  0,-10,-20,-30,
-        -30,-10, 20, 30, 30, 20,-10,-30,
-        -30,-10, 30, 40, 40, 30,-10,-30,
-        -30,-10, 30, 40, 40, 30,-10,-30,
-        -30,-10, 20, 30, 30, 20,-10,-30,
-        -30,-30,  0,  0,  0,  0,-30,-30,
-        -50,-30,-30,-30,-30,-30,-30,-50
-};
-
-int evaluate_board(const vector<vector<Piece>>& board) {
-    int score = 0;
-    bool is_endgame = false;
-    int material_sum = 0;
-
-    // First pass: count material to determine if we're in endgame
-#pragma omp parallel for reduction(+:material_sum) collapse(2)
-    for (int row = 0; row < BOARD_SIZE; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            Piece piece = board[row][col];
-            switch (piece) {
-                case WHITE_QUEEN: case BLACK_QUEEN: material_sum += 900; break;
-                case WHITE_ROOK: case BLACK_ROOK: material_sum += 500; break;
-                case WHITE_BISHOP: case WHITE_KNIGHT:
-                case BLACK_BISHOP: case BLACK_KNIGHT: material_sum += 300; break;
-                default: break;
-            }
-        }
-    }
-    is_endgame = material_sum <= 3000;  // Threshold for endgame
-
-#pragma omp parallel for reduction(+:score) collapse(2)
-    for (int row = 0; row < BOARD_SIZE; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            Piece piece = board[row][col];
-            int square_idx = row * 8 + col;
-            int reverse_idx = (7 - row) * 8 + col;
-
-            int piece_value = 0;
-            int position_value = 0;
-
-            switch (piece) {
-                case WHITE_PAWN:
-                    piece_value = 100;
-                    position_value = pawn_table[square_idx];
-                    break;
-                case BLACK_PAWN:
-                    piece_value = -100;
-                    position_value = -pawn_table[reverse_idx];
-                    break;
-                case WHITE_KNIGHT:
-                    piece_value = 320;
-                    position_value = knight_table[square_idx];
-                    break;
-                case BLACK_KNIGHT:
-                    piece_value = -320;
-                    position_value = -knight_table[reverse_idx];
-                    break;
-                case WHITE_BISHOP:
-                    piece_value = 330;
-                    position_value = bishop_table[square_idx];
-                    break;
-                case BLACK_BISHOP:
-                    piece_value = -330;
-                    position_value = -bishop_table[reverse_idx];
-                    break;
-                case WHITE_ROOK:
-                    piece_value = 500;
-                    position_value = rook_table[square_idx];
-                    break;
-                case BLACK_ROOK:
-                    piece_value = -500;
-                    position_value = -rook_table[reverse_idx];
-                    break;
-                case WHITE_QUEEN:
-                    piece_value = 900;
-                    position_value = queen_table[square_idx];
-                    break;
-                case BLACK_QUEEN:
-                    piece_value = -900;
-                    position_value = -queen_table[reverse_idx];
-                    break;
-                case WHITE_KING:
-                    piece_value = 20000;
-                    position_value = is_endgame ?
-                                     king_endgame_table[square_idx] :
-                                     king_table[square_idx];
-                    break;
-                case BLACK_KING:
-                    piece_value = -20000;
-                    position_value = is_endgame ?
-                                     -king_endgame_table[reverse_idx] :
-                                     -king_table[reverse_idx];
-                    break;
-                default:
-                    break;
-            }
-            score += piece_value + position_value;
-        }
-    }
-    return score;
-}
-
-bool is_valid_position(int row, int col) {
-    return row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE;
-}
-
-void add_move_if_valid(vector<Move>& moves, const vector<vector<Piece>>& board,
-                       int fromRow, int fromCol, int toRow, int toCol, bool isWhiteTurn) {
-    if (!is_valid_position(toRow, toCol)) return;
-
-    Piece target = board[toRow][toCol];
-    if (target == EMPTY || (isWhiteTurn && is_black(target)) || (!isWhiteTurn && is_white(target))) {
-        moves.push_back({fromRow, fromCol, toRow, toCol, 0});
-    }
-}
-
-void add_sliding_moves(vector<Move>& moves, const vector<vector<Piece>>& board,
-                       int fromRow, int fromCol, bool isWhiteTurn,
-                       const vector<pair<int, int>>& directions) {
-    for (const auto& dir : directions) {
-        int row = fromRow + dir.first;
-        int col = fromCol + dir.second;
-
-        while (is_valid_position(row, col)) {
-            Piece target = board[row][col];
-            if (target == EMPTY) {
-                moves.push_back({fromRow, fromCol, row, col, 0});
-            } else {
-                if ((isWhiteTurn && is_black(target)) || (!isWhiteTurn && is_white(target))) {
-                    moves.push_back({fromRow, fromCol, row, col, 0});
-                }
-                break;
-            }
-            row += dir.first;
-            col += dir.second;
-        }
-    }
-}
-
-vector<Move> generate_moves(const vector<vector<Piece>>& board, bool isWhiteTurn) {
-    vector<Move> moves;
-#pragma omp parallel
-    {
-        vector<Move> local_moves;
-#pragma omp for collapse(2) nowait
-        for (int row = 0; row < BOARD_SIZE; ++row) {
-            for (int col = 0; col < BOARD_SIZE; ++col) {
-                Piece piece = board[row][col];
-                if (piece == EMPTY) continue;
-
-                if ((isWhiteTurn && !is_white(piece)) || (!isWhiteTurn && !is_black(piece))) continue;
-
-                switch (piece) {
-                    case WHITE_PAWN: case BLACK_PAWN: {
-                        int direction = (piece == WHITE_PAWN) ? -1 : 1;
-                        int startRow = (piece == WHITE_PAWN) ? 6 : 1;
-
-                        // Forward move
-                        if (is_valid_position(row + direction, col) &&
-                            board[row + direction][col] == EMPTY) {
-                            local_moves.push_back({row, col, row + direction, col, 0});
-
-                            // Double move from starting position
-                            if (row == startRow && board[row + 2 * direction][col] == EMPTY) {
-                                local_moves.push_back({row, col, row + 2 * direction, col, 0});
-                            }
-                        }
-
-                        // Captures
-                        for (int dc : {-1, 1}) {
-                            if (is_valid_position(row + direction, col + dc)) {
-                                Piece target = board[row + direction][col + dc];
-                                if (target != EMPTY &&
-                                    ((isWhiteTurn && is_black(target)) ||
-                                     (!isWhiteTurn && is_white(target)))) {
-                                    local_moves.push_back({row, col, row + direction, col + dc, 0});
-                                }
-                            }
-                        }
-                        break;
-                    }
-
-                    case WHITE_KNIGHT: case BLACK_KNIGHT: {
-                        vector<pair<int, int>> knight_moves = {
-                                {-2, -1}, {-2, 1}, {-1, -2}, {-1, 2},
-                                {1, -2}, {1, 2}, {2, -1}, {2, 1}
-                        };
-                        for (const auto& move : knight_moves) {
-                            add_move_if_valid(local_moves, board, row, col,
-                                              row + move.first, col + move.second, isWhiteTurn);
-                        }
-                        break;
-                    }
-
-                    case WHITE_BISHOP: case BLACK_BISHOP: {
-                        vector<pair<int, int>> bishop_dirs = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
-                        add_sliding_moves(local_moves, board, row, col, isWhiteTurn, bishop_dirs);
-                        break;
-                    }
-
-                    case WHITE_ROOK: case BLACK_ROOK: {
-                        vector<pair<int, int>> rook_dirs = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
-                        add_sliding_moves(local_moves, board, row, col, isWhiteTurn, rook_dirs);
-                        break;
-                    }
-
-                    case WHITE_QUEEN: case BLACK_QUEEN: {
-                        vector<pair<int, int>> queen_dirs = {
-                                {-1, -1}, {-1, 0}, {-1, 1}, {0, -1},
-                                {0, 1}, {1, -1}, {1, 0}, {1, 1}
-                        };
-                        add_sliding_moves(local_moves, board, row, col, isWhiteTurn, queen_dirs);
-                        break;
-                    }
-
-                    case WHITE_KING: case BLACK_KING: {
-                        vector<pair<int, int>> king_moves = {
-                                {-1, -1}, {-1, 0}, {-1, 1}, {0, -1},
-                                {0, 1}, {1, -1}, {1, 0}, {1, 1}
-                        };
-                        for (const auto& move : king_moves) {
-                            add_move_if_valid(local_moves, board, row, col,
-                                              row + move.first, col + move.second, isWhiteTurn);
-                        }
-                        break;
-                    }
-                }
-            }
-        }
-#pragma omp critical
-        {
-            moves.insert(moves.end(), local_moves.begin(), local_moves.end());
-        }
-    }
-    return moves;
-}
-
-int minimax(vector<vector<Piece>> board, int depth, bool isWhiteTurn, int alpha, int beta) {
-    if (depth == 0) {
-        return evaluate_board(board);
-    }
-
-    vector<Move> moves = generate_moves(board, isWhiteTurn);
-    if (moves.empty()) return evaluate_board(board);
-
-    if (isWhiteTurn) {
-        int maxEval = INT_MIN;
-#pragma omp parallel for reduction(max:maxEval) schedule(dynamic)
-        for (int i = 0; i < moves.size(); ++i) {
-            auto newBoard = board;
-            const auto& move = moves[i];
-            newBoard[move.toRow][move.toCol] = newBoard[move.fromRow][move.fromCol];
-            newBoard[move.fromRow][move.fromCol] = EMPTY;
-            int eval = minimax(newBoard, depth - 1, false, alpha, beta);
-            maxEval = max(maxEval, eval);
-        }
-        return maxEval;
-    } else {
-        int minEval = INT_MAX;
-#pragma omp parallel for reduction(min:minEval) schedule(dynamic)
-        for (int i = 0; i < moves.size(); ++i) {
-            auto newBoard = board;
-            const auto& move = moves[i];
-            newBoard[move.toRow][move.toCol] = newBoard[move.fromRow][move.fromCol];
-            newBoard[move.fromRow][move.fromCol] = EMPTY;
-            int eval = minimax(newBoard, depth - 1, true, alpha, beta);
-            minEval = min(minEval, eval);
-        }
-        return minEval;
-    }
-}
-
-Move best_move(vector<vector<Piece>>& board, int depth) {
-    vector<Move> moves = generate_moves(board, true);
-    atomic<int> bestScore{INT_MIN};
-    Move bestMove{-1, -1, -1, -1, INT_MIN};
 
-#pragma omp parallel
-    {
-        Move localBestMove{-1, -1, -1, -1, INT_MIN};
-        int localBestScore = INT_MIN;
-
-#pragma omp for schedule(dynamic)
-        for (int i = 0; i < moves.size(); ++i) {
-            auto newBoard = board;
-            Move& move = moves[i];
-
-            newBoard[move.toRow][move.toCol] = newBoard[move.fromRow][move.fromCol];
-            newBoard[move.fromRow][move.fromCol] = EMPTY;
-
-            int score = minimax(newBoard, depth - 1, false, INT_MIN, INT_MAX);
-            move.score = score;
-
-            if (score > localBestScore) {
-                localBestScore = score;
-                localBestMove = move;
-            }
-        }
-
-#pragma omp critical
-        {
-            if (localBestScore > bestScore) {
-                bestScore = localBestScore;
-                bestMove = localBestMove;
-            }
-        }
-    }
-    return bestMove;
-}
-
-void draw_board(sf::RenderWindow& window, vector<vector<Piece>>& board, Move bestMove) {
+void draw_board(sf::RenderWindow& window, const Position& board, Move bestMove) {
     sf::RectangleShape square(sf::Vector2f(TILE_SIZE, TILE_SIZE));
     sf::Font font;
     font.loadFromFile("C:/Windows/Fonts/arial.ttf");
@@ -422,14 +18,14 @@ void draw_board(sf::RenderWindow& window, vector<vector<Piece>>& board, Move bes
             square.setPosition(col * TILE_SIZE, row * TILE_SIZE);
             square.setFillColor((row + col) % 2 == 0 ? sf::Color::White : sf::Color(100, 100, 100));
 
-            if (row == bestMove.fromRow && col == bestMove.fromCol) {
+            if (bestMove != MOVE_NONE && square_of(row, col) == bestMove.from()) {
                 square.setFillColor(sf::Color::Yellow);
-            } else if (row == bestMove.toRow && col == bestMove.toCol) {
+            } else if (bestMove != MOVE_NONE && square_of(row, col) == bestMove.to()) {
                 square.setFillColor(sf::Color::Green);
             }
             window.draw(square);
 
-            Piece p = board[row][col];
+            Piece p = board.at(row, col);
             if (p != EMPTY) {
                 sf::Text text;
                 text.setFont(font);
@@ -460,84 +56,14 @@ void draw_board(sf::RenderWindow& window, vector<vector<Piece>>& board, Move bes
     }
 }
 
-bool is_king_in_check(const vector<vector<Piece>>& board, bool isWhiteKing) {
-    // Find king's position
-    int kingRow = -1, kingCol = -1;
-    Piece targetKing = isWhiteKing ? WHITE_KING : BLACK_KING;
-
-    for (int row = 0; row < BOARD_SIZE; ++row) {
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            if (board[row][col] == targetKing) {
-                kingRow = row;
-                kingCol = col;
-                break;
-            }
-        }
-        if (kingRow != -1) break;
-    }
-
-    // Generate all opponent's moves and see if any can capture the king
-    vector<Move> opponentMoves = generate_moves(board, !isWhiteKing);
-    for (const auto& move : opponentMoves) {
-        if (move.toRow == kingRow && move.toCol == kingCol) {
-            return true;
-        }
-    }
-    return false;
-}
-
-bool is_checkmate(const vector<vector<Piece>>& board, bool isWhiteTurn) {
-    // If not in check, it's not checkmate
-    if (!is_king_in_check(board, isWhiteTurn)) {
-        return false;
-    }
-
-    // Try all possible moves to see if any can get out of check
-    vector<Move> moves = generate_moves(board, isWhiteTurn);
-    for (const auto& move : moves) {
-        // Make move
-        auto tempBoard = board;
-        tempBoard[move.toRow][move.toCol] = tempBoard[move.fromRow][move.fromCol];
-        tempBoard[move.fromRow][move.fromCol] = EMPTY;
-
-        // If this move gets us out of check, it's not checkmate
-        if (!is_king_in_check(tempBoard, isWhiteTurn)) {
-            return false;
-        }
-    }
-    return true;
-}
-
-bool is_stalemate(const vector<vector<Piece>>& board, bool isWhiteTurn) {
-    // If in check, it's not stalemate
-    if (is_king_in_check(board, isWhiteTurn)) {
-        return false;
-    }
-
-    // If there are no legal moves, it's stalemate
-    vector<Move> moves = generate_moves(board, isWhiteTurn);
-    for (const auto& move : moves) {
-        // Make move
-        auto tempBoard = board;
-        tempBoard[move.toRow][move.toCol] = tempBoard[move.fromRow][move.fromCol];
-        tempBoard[move.fromRow][move.fromCol] = EMPTY;
-
-        // If this move doesn't put us in check, it's a legal move
-        if (!is_king_in_check(tempBoard, isWhiteTurn)) {
-            return false;
-        }
-    }
-    return true;
-}
-
 class ChessGame {
 private:
-    vector<vector<Piece>> board;
+    Position board;
     sf::RenderWindow& window;
     bool isWhiteTurn;
     bool pieceSelected;
     int selectedRow, selectedCol;
-    vector<Move> validMoves;
+    MoveList validMoves;
     sf::Font font;
     sf::Texture pieceTextures[13];  // One for each piece type including EMPTY
     sf::Sprite pieceSprites[13];
@@ -546,45 +72,40 @@ private:
     Piece draggedPiece;
     bool gameOver;
     string gameOverMessage;
+    SearchMode searchMode;
+    SearchLimits searchLimits;
+    bool reportOverhead;
+    bool ponderEnabled;
+    BackgroundSearch aiSearch;
+    bool isPondering;  // aiSearch is searching the reply to ponderMove
+    Move ponderMove;
 
 public:
-    ChessGame(sf::RenderWindow& win) : window(win), isWhiteTurn(true), pieceSelected(false),
-                                       isDragging(false), draggedPiece(EMPTY), gameOver(false) {
-        // Initialize board
-        board = vector<vector<Piece>>(BOARD_SIZE, vector<Piece>(BOARD_SIZE, EMPTY));
-
-        // Initial board setup
-        // Back rank pieces
-        board[0][0] = BLACK_ROOK;
-        board[0][1] = BLACK_KNIGHT;
-        board[0][2] = BLACK_BISHOP;
-        board[0][3] = BLACK_QUEEN;
-        board[0][4] = BLACK_KING;
-        board[0][5] = BLACK_BISHOP;
-        board[0][6] = BLACK_KNIGHT;
-        board[0][7] = BLACK_ROOK;
-
-        board[7][0] = WHITE_ROOK;
-        board[7][1] = WHITE_KNIGHT;
-        board[7][2] = WHITE_BISHOP;
-        board[7][3] = WHITE_QUEEN;
-        board[7][4] = WHITE_KING;
-        board[7][5] = WHITE_BISHOP;
-        board[7][6] = WHITE_KNIGHT;
-        board[7][7] = WHITE_ROOK;
-
-        // Pawns
-        for (int col = 0; col < BOARD_SIZE; ++col) {
-            board[1][col] = BLACK_PAWN;
-            board[6][col] = WHITE_PAWN;
-        }
+    ChessGame(sf::RenderWindow& win, SearchMode mode = YBWC_SEARCH,
+              const SearchLimits& limits = SearchLimits(), bool overhead = false, bool ponder = true,
+              const string& fen = STARTPOS_FEN)
+            : window(win), isWhiteTurn(true), pieceSelected(false), isDragging(false), draggedPiece(EMPTY),
+              gameOver(false), searchMode(mode), searchLimits(limits), reportOverhead(overhead),
+              ponderEnabled(ponder), isPondering(false), ponderMove(MOVE_NONE) {
+        // Initial board setup; main has already checked the FEN
+        board.set_fen(fen, isWhiteTurn);
+        checkGameOver(isWhiteTurn);
 
         // Load font
         font.loadFromFile("C:/Windows/Fonts/arial.ttf");
+
+        // The AI plays black, so it opens when the position has black to move
+        startAiSearch(MOVE_NONE);
     }
 
     void handleInput(const sf::Event& event) {
+        // F prints the position as FEN, to be reloaded later with --fen
+        if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F) {
+            cout << board.to_fen(isWhiteTurn) << endl;
+            return;
+        }
         if (gameOver) return;  // Ignore input if game is over
+        if (aiSearch.running() && !isPondering) return;  // The board is the AI's until it moves
 
         switch (event.type) {
             case sf::Event::MouseButtonPressed: {
@@ -594,7 +115,7 @@ public:
 
                     if (row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE) {
                         if (!pieceSelected) {
-                            Piece piece = board[row][col];
+                            Piece piece = board.at(row, col);
                             if ((isWhiteTurn && is_white(piece)) || (!isWhiteTurn && is_black(piece))) {
                                 pieceSelected = true;
                                 selectedRow = row;
@@ -602,21 +123,15 @@ public:
                                 validMoves = generate_moves(board, isWhiteTurn);
                                 isDragging = true;
                                 dragStart = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
-                                draggedPiece = board[row][col];
+                                draggedPiece = board.at(row, col);
                             }
                         } else {
                             // Try to make a move
-                            Move move = {selectedRow, selectedCol, row, col, 0};
+                            Move move(square_of(selectedRow, selectedCol), square_of(row, col));
                             if (isValidMove(move)) {
                                 makeMove(move);
                                 isWhiteTurn = !isWhiteTurn;
-
-                                // AI's turn
-                                if (!isWhiteTurn) {
-                                    Move aiMove = best_move(board, MAX_DEPTH);
-                                    makeMove(aiMove);
-                                    isWhiteTurn = true;
-                                }
+                                startAiSearch(move);
                             }
                             pieceSelected = false;
                             isDragging = false;
@@ -632,17 +147,11 @@ public:
                     int col = event.mouseButton.x / TILE_SIZE;
 
                     if (row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE) {
-                        Move move = {selectedRow, selectedCol, row, col, 0};
+                        Move move(square_of(selectedRow, selectedCol), square_of(row, col));
                         if (isValidMove(move)) {
                             makeMove(move);
                             isWhiteTurn = !isWhiteTurn;
-
-                            // AI's turn
-                            if (!isWhiteTurn) {
-                                Move aiMove = best_move(board, MAX_DEPTH);
-                                makeMove(aiMove);
-                                isWhiteTurn = true;
-                            }
+                            startAiSearch(move);
                         }
                     }
                     pieceSelected = false;
@@ -662,40 +171,85 @@ public:
         }
     }
 
+    // Black's reply to playerMove is searched in the background so the
+    // window keeps redrawing; update() plays it once it is ready. If the AI
+    // was pondering on that very move, its search simply carries on.
+    void startAiSearch(const Move& playerMove) {
+        if (isPondering) {
+            isPondering = false;
+            if (playerMove == ponderMove && !gameOver) {
+                ponder_hit();
+                return;
+            }
+            aiSearch.cancel();
+        }
+        if (isWhiteTurn || gameOver) return;
+        aiSearch.start(board, false, searchMode, searchLimits, reportOverhead);
+    }
+
+    // While the player thinks, searches black's reply to the move the last
+    // search expects from white, warming the transposition table either way
+    void startPondering(const Move& expected) {
+        if (!ponderEnabled || gameOver || expected == MOVE_NONE) return;
+        Position next = board;
+        UndoInfo undo;
+        next.make_move(expected, undo);
+        SearchLimits limits = searchLimits;
+        limits.ponder = true;
+        aiSearch.start(next, false, searchMode, limits, reportOverhead);
+        ponderMove = expected;
+        isPondering = true;
+    }
+
+    // Called every frame: plays the AI's move once its search has finished
+    // and logs the engine's throughput
+    void update() {
+        if (isPondering || !aiSearch.ready()) return;
+        SearchResult result = aiSearch.get();
+        const SearchStats& stats = result.stats;
+        cout << search_mode_name(searchMode) << ": depth " << stats.depth << ", score " << stats.score
+             << ", " << stats.nodes << " nodes in " << stats.seconds << "s ("
+             << uint64_t(stats.nodes / max(stats.seconds, 1e-9)) << " nodes/sec)" << endl;
+        if (reportOverhead && searchMode != BEST_FIRST_SEARCH) {
+            cout << "search overhead: " << result.overhead << endl;
+        }
+        if (result.move == MOVE_NONE) return;
+        Move expected = ponder_move(board, false, result.move);
+        makeMove(result.move);
+        isWhiteTurn = true;
+        startPondering(expected);
+    }
+
     void makeMove(const Move& move) {
-        board[move.toRow][move.toCol] = board[move.fromRow][move.fromCol];
-        board[move.fromRow][move.fromCol] = EMPTY;
+        UndoInfo undo;
+        board.make_move(move, undo);
 
         // Check game state after move
-        if (is_checkmate(board, !isWhiteTurn)) {
+        checkGameOver(!isWhiteTurn);
+    }
+
+    // Ends the game when the side to move has no legal moves
+    void checkGameOver(bool whiteToMove) {
+        if (is_checkmate(board, whiteToMove)) {
             gameOver = true;
-            gameOverMessage = isWhiteTurn ? "White wins by checkmate!" : "Black wins by checkmate!";
-        } else if (is_stalemate(board, !isWhiteTurn)) {
+            gameOverMessage = whiteToMove ? "Black wins by checkmate!" : "White wins by checkmate!";
+        } else if (is_stalemate(board, whiteToMove)) {
             gameOver = true;
             gameOverMessage = "Game drawn by stalemate!";
         }
     }
 
-    bool isValidMove(const Move& move) {
-        // First check if it's in the list of generated moves
-        bool foundMove = false;
+    // Looks the move up among the legal moves and copies its flags, so
+    // castling and en passant play out; pawns always promote to a queen
+    bool isValidMove(Move& move) {
         for (const auto& validMove : validMoves) {
-            if (validMove.fromRow == move.fromRow &&
-                validMove.fromCol == move.fromCol &&
-                validMove.toRow == move.toRow &&
-                validMove.toCol == move.toCol) {
-                foundMove = true;
-                break;
+            if (validMove.from() == move.from() && validMove.to() == move.to() &&
+                (!is_promotion(validMove) || validMove.flags() == PROMOTE_QUEEN)) {
+                move = validMove;
+                return true;
             }
         }
-        if (!foundMove) return false;
-
-        // Then check if it would leave us in check
-        auto tempBoard = board;
-        tempBoard[move.toRow][move.toCol] = tempBoard[move.fromRow][move.fromCol];
-        tempBoard[move.fromRow][move.fromCol] = EMPTY;
-
-        return !is_king_in_check(tempBoard, isWhiteTurn);
+        return false;
     }
 
     void draw() {
@@ -717,10 +271,8 @@ public:
                     } else {
                         // Highlight valid moves
                         for (const auto& move : validMoves) {
-                            if (move.fromRow == selectedRow &&
-                                move.fromCol == selectedCol &&
-                                move.toRow == row &&
-                                move.toCol == col) {
+                            if (move.from() == square_of(selectedRow, selectedCol) &&
+                                move.to() == square_of(row, col)) {
                                 square.setFillColor(sf::Color(130, 151, 105, 200));
                                 break;
                             }
@@ -731,7 +283,7 @@ public:
                 window.draw(square);
 
                 // Draw pieces
-                Piece piece = board[row][col];
+                Piece piece = board.at(row, col);
                 if (piece != EMPTY && (!isDragging || row != selectedRow || col != selectedCol)) {
                     sf::Text text;
                     text.setFont(font);
@@ -813,19 +365,62 @@ public:
         window.display();
     }
 
-    const vector<vector<Piece>>& getBoard() const {
+    const Position& getBoard() const {
         return board;
     }
 };
 
-int main() {
-    omp_set_num_threads(omp_get_max_threads());
+int main(int argc, char* argv[]) {
+    init_bitboards();
+
+    // --best-first, --lazy-smp or --alpha-beta (splitting only the root) play
+    // the AI with that engine instead of YBWC, and --overhead also logs its
+    // search overhead after each move.
+    // The AI ponders on the player's time unless --no-ponder is given;
+    // --hash=MB sets the transposition table size, --threads=N the search pool
+    // size and --split-depth=N the remaining depth at which YBWC splits nodes.
+    // --depth=N, --movetime=MS and --nodes=N bound each AI move; with only a
+    // time or node budget the search deepens until the budget runs out.
+    // --fen=FEN starts the game from that position instead of the initial
+    // one. The perft commands live in ChessAI-bench.
+    SearchMode mode = YBWC_SEARCH;
+    SearchLimits limits;
+    bool depthSet = false;
+    bool reportOverhead = false;
+    bool ponder = true;
+    int threads = max(1u, thread::hardware_concurrency());
+    string fen = STARTPOS_FEN;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--best-first") mode = BEST_FIRST_SEARCH;
+        else if (arg == "--lazy-smp") mode = LAZY_SMP_SEARCH;
+        else if (arg == "--ybwc") mode = YBWC_SEARCH;
+        else if (arg == "--alpha-beta") mode = ALPHA_BETA_SEARCH;
+        else if (arg == "--overhead") reportOverhead = true;
+        else if (arg == "--no-ponder") ponder = false;
+        else if (arg.rfind("--hash=", 0) == 0) transposition_table.resize(stoul(arg.substr(7)));
+        else if (arg.rfind("--threads=", 0) == 0) threads = stoi(arg.substr(10));
+        else if (arg.rfind("--split-depth=", 0) == 0) search_split_depth = stoi(arg.substr(14));
+        else if (arg.rfind("--depth=", 0) == 0) limits.maxDepth = stoi(arg.substr(8)), depthSet = true;
+        else if (arg.rfind("--movetime=", 0) == 0) limits.seconds = stoi(arg.substr(11)) / 1000.0;
+        else if (arg.rfind("--nodes=", 0) == 0) limits.nodes = stoull(arg.substr(8));
+        else if (arg.rfind("--fen=", 0) == 0) fen = arg.substr(6);
+    }
+    if (!depthSet && (limits.seconds > 0 || limits.nodes)) limits.maxDepth = MAX_ITERATIONS;
+    search_pool.resize(threads);
+
+    Position board;
+    bool isWhiteTurn = true;
+    if (!board.set_fen(fen, isWhiteTurn)) {
+        cerr << "invalid FEN: " << fen << endl;
+        return 1;
+    }
 
     sf::RenderWindow window(sf::VideoMode(BOARD_SIZE * TILE_SIZE, BOARD_SIZE * TILE_SIZE),
                             "Chess AI", sf::Style::Titlebar | sf::Style::Close);
     window.setFramerateLimit(60);
 
-    ChessGame game(window);
+    ChessGame game(window, mode, limits, reportOverhead, ponder, fen);
 
     while (window.isOpen()) {
         sf::Event event;
@@ -836,6 +431,7 @@ int main() {
             game.handleInput(event);
         }
 
+        game.update();
         game.draw();
     }
 
@@ -0,0 +1,255 @@
+#include <condition_variable>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "perft.h"
+#include "search.h"
+
+using namespace std;
+
+// Headless front end speaking the Universal Chess Interface over stdin and
+// stdout, for match managers and analysis without a display. Searches run
+// on a background thread so "stop" and "isready" are answered while one is
+// in progress.
+
+// Score for an info line: centipawns, or moves to mate. Mate scores count
+// the depth left at the mated node, so the distance follows from the depth
+// of the iteration that found it.
+string uci_score(int score, int depth) {
+    if (abs(score) < MATE_THRESHOLD) return "cp " + to_string(score);
+    int plies = max(depth - (abs(score) - MATE_SCORE), 1);
+    int moves = (plies + 1) / 2;
+    return "mate " + to_string(score > 0 ? moves : -moves);
+}
+
+// Time to spend on one move: an even share of the clock over the moves to
+// go (30 when not given) plus most of the increment, never more than half
+// of what is left
+double allot_seconds(int remainingMs, int incrementMs, int movesToGo) {
+    double share = double(remainingMs) / max(movesToGo, 1) + 0.75 * incrementMs;
+    return max(min(share, remainingMs / 2.0), 1.0) / 1000.0;
+}
+
+class UciSession {
+private:
+    Position board;
+    bool isWhiteTurn;
+    thread searcher;
+    mutex outputLock;
+    // A ponder search holds back its bestmove until "ponderhit" or "stop",
+    // an infinite one until "stop"
+    mutex ponderLock;
+    condition_variable ponderCv;
+    bool holdBestMove;
+    bool infiniteSearch;
+
+public:
+    UciSession() : isWhiteTurn(true), holdBestMove(false), infiniteSearch(false) {
+        board.set_fen(STARTPOS_FEN, isWhiteTurn);
+    }
+
+    ~UciSession() {
+        stopSearch();
+    }
+
+    // Reads commands until "quit" or the end of input
+    void run() {
+        string line;
+        while (getline(cin, line)) {
+            istringstream in(line);
+            string command;
+            in >> command;
+
+            if (command == "uci") {
+                send("id name ChessAI\n"
+                     "id author abdulrahman-elnabawi\n"
+                     "option name Threads type spin default " + to_string(max(search_pool.size(), 1)) +
+                     " min 1 max 1024\n"
+                     "option name Hash type spin default " + to_string(TT_DEFAULT_MB) + " min 1 max 65536\n"
+                     "option name Ponder type check default false\n"
+                     "uciok");
+            } else if (command == "isready") {
+                send("readyok");
+            } else if (command == "setoption") {
+                waitForSearch();
+                setOption(in);
+            } else if (command == "ucinewgame") {
+                waitForSearch();
+                transposition_table.clear();
+            } else if (command == "position") {
+                waitForSearch();
+                setPosition(in);
+            } else if (command == "go") {
+                waitForSearch();
+                go(in);
+            } else if (command == "ponderhit") {
+                ponder_hit();
+                if (!infiniteSearch) releaseBestMove();
+            } else if (command == "stop") {
+                stopSearch();
+            } else if (command == "quit") {
+                break;
+            }
+        }
+        stopSearch();
+    }
+
+private:
+    void send(const string& text) {
+        lock_guard<mutex> lock(outputLock);
+        cout << text << endl;
+    }
+
+    // setoption name <name> value <value>; names may contain spaces. Values
+    // are clamped to the range advertised by "uci"; bad ones are ignored.
+    void setOption(istringstream& in) {
+        string token, name, value;
+        in >> token;  // "name"
+        while (in >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+        in >> value;
+        if (value.empty()) return;
+
+        int number;
+        if (!(istringstream(value) >> number)) {
+            send("info string invalid value " + value);
+            return;
+        }
+        if (name == "Threads") search_pool.resize(min(max(number, 1), 1024));
+        else if (name == "Hash") transposition_table.resize(min(max(number, 1), 65536));
+    }
+
+    // position startpos|fen <fen> [moves <move>...]
+    void setPosition(istringstream& in) {
+        string token, fen;
+        in >> token;
+        if (token == "startpos") {
+            fen = STARTPOS_FEN;
+            in >> token;
+        } else if (token == "fen") {
+            while (in >> token && token != "moves") fen += token + " ";
+        }
+
+        Position next;
+        bool nextWhite = true;
+        if (!next.set_fen(fen, nextWhite)) {
+            send("info string invalid position");
+            return;
+        }
+        if (token == "moves") {
+            while (in >> token) {
+                Move move = findMove(next, nextWhite, token);
+                if (move == MOVE_NONE) {
+                    send("info string illegal move " + token);
+                    return;
+                }
+                UndoInfo undo;
+                next.make_move(move, undo);
+                nextWhite = !nextWhite;
+            }
+        }
+        board = next;
+        isWhiteTurn = nextWhite;
+    }
+
+    static Move findMove(const Position& position, bool whiteToMove, const string& text) {
+        for (const Move& move : generate_moves(position, whiteToMove)) {
+            if (move_to_uci(move) == text) return move;
+        }
+        return MOVE_NONE;
+    }
+
+    // go [ponder] [depth N] [movetime MS] [nodes N] [wtime MS] [btime MS]
+    // [winc MS] [binc MS] [movestogo N] [infinite] | go perft N
+    void go(istringstream& in) {
+        SearchLimits limits;
+        bool depthSet = false, infinite = false;
+        int clock[2] = {0, 0}, increment[2] = {0, 0}, movesToGo = 30;
+        string token;
+        while (in >> token) {
+            if (token == "perft") {
+                int depth = 1;
+                in >> depth;
+                lock_guard<mutex> lock(outputLock);
+                perft_root(board, depth, isWhiteTurn, true);
+                return;
+            }
+            int ms = 0;
+            if (token == "ponder") limits.ponder = true;
+            else if (token == "depth") in >> limits.maxDepth, depthSet = true;
+            else if (token == "movetime") in >> ms, limits.seconds = ms / 1000.0;
+            else if (token == "nodes") in >> limits.nodes;
+            else if (token == "wtime") in >> clock[WHITE];
+            else if (token == "btime") in >> clock[BLACK];
+            else if (token == "winc") in >> increment[WHITE];
+            else if (token == "binc") in >> increment[BLACK];
+            else if (token == "movestogo") in >> movesToGo;
+            else if (token == "infinite") infinite = true;
+        }
+        const Color us = isWhiteTurn ? WHITE : BLACK;
+        if (infinite) limits.seconds = 0, limits.nodes = 0;
+        else if (limits.seconds == 0 && clock[us] > 0) limits.seconds = allot_seconds(clock[us], increment[us], movesToGo);
+        // Without a depth the search deepens until its budget runs out or
+        // "stop" arrives
+        if (!depthSet) limits.maxDepth = MAX_ITERATIONS;
+
+        stop_search = false;
+        pondering = limits.ponder;
+        holdBestMove = limits.ponder || infinite;
+        infiniteSearch = infinite;
+        searcher = thread([this, limits] {
+            Position root = board;
+            SearchStats stats;
+            // YBWC splits interior nodes too, after their eldest move, so
+            // it keeps every thread busy with little wasted work
+            Move move = find_best_move(root, isWhiteTurn, YBWC_SEARCH, limits, stats);
+            // UCI forbids answering a ponder or infinite search before the
+            // GUI decides
+            {
+                unique_lock<mutex> lock(ponderLock);
+                ponderCv.wait(lock, [this] { return !holdBestMove; });
+            }
+            // The reply the search expects is sent as the move to ponder on
+            Move reply = move != MOVE_NONE ? ponder_move(root, isWhiteTurn, move) : MOVE_NONE;
+            string pv = move_to_uci(move) + (reply != MOVE_NONE ? " " + move_to_uci(reply) : "");
+            // Stopped before the first iteration finished: no score to report
+            if (stats.depth > 0) {
+                send("info depth " + to_string(stats.depth) + " score " + uci_score(stats.score, stats.depth) +
+                     " nodes " + to_string(stats.nodes) + " nps " +
+                     to_string(uint64_t(stats.nodes / max(stats.seconds, 1e-9))) + " time " +
+                     to_string(int(stats.seconds * 1000)) + " pv " + pv);
+            }
+            if (move == MOVE_NONE) send("bestmove 0000");
+            else send("bestmove " + move_to_uci(move) + (reply != MOVE_NONE ? " ponder " + move_to_uci(reply) : ""));
+        });
+    }
+
+    void stopSearch() {
+        if (!searcher.joinable()) return;
+        stop_search = true;
+        releaseBestMove();
+        searcher.join();
+    }
+
+    void releaseBestMove() {
+        {
+            lock_guard<mutex> lock(ponderLock);
+            holdBestMove = false;
+        }
+        ponderCv.notify_all();
+    }
+
+    void waitForSearch() {
+        if (searcher.joinable()) searcher.join();
+    }
+};
+
+int main() {
+    init_bitboards();
+    search_pool.resize(max(1u, thread::hardware_concurrency()));
+
+    UciSession session;
+    session.run();
+    return 0;
+}